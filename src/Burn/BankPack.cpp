@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Bank packing, see BankPack.h
+ */
+#include "Burn.h"
+#include "BankPack.h"
+#include "FieldFile.h"
+#include "Timer.h"
+#include <sstream>
+
+bool BankPack::setFile(std::string s)
+{
+   packFile = s;
+   return true;
+}
+
+std::string BankPack::getFile(void)
+{
+   return packFile;
+}
+
+//Laid out like a Manifest, a line needs a bank and a file and a bank
+//can only be listed once
+bool BankPack::load(void)
+{
+   FieldFile in;
+   std::vector<std::string> f;
+   std::ostringstream err;
+   PackBank b;
+
+   banks.clear();
+   error.clear();
+
+   if(!in.open(packFile))
+   {
+      error = "couldn't open " + packFile;
+      return false;
+   }
+
+   while(in.next(f))
+   {
+      if(f.size() < 2)
+      {
+         err << "line " << in.getLine() << ": needs bank and file";
+         break;
+      }
+      if(!FieldFile::parseBank(f[0], b.bank))
+      {
+         err << "line " << in.getLine() << ": bad bank " << f[0];
+         break;
+      }
+      if(f.size() > 2)
+      {
+         err << "line " << in.getLine() << ": too many fields";
+         break;
+      }
+      b.file = f[1];
+
+      for(unsigned int i = 0; i < banks.size(); i++)
+         if(banks[i].bank == b.bank)
+            err << "line " << in.getLine() << ": bank " << b.bank << " is already on line " << banks[i].line;
+      if(!err.str().empty())
+         break;
+
+      b.line = in.getLine();
+      b.done = b.ok = b.written = false;
+      b.millis = 0;
+      b.failedAt.clear();
+      banks.push_back(b);
+   }
+
+   if(!err.str().empty())
+   {
+      error = err.str();
+      banks.clear();
+      return false;
+   }
+   if(banks.empty())
+   {
+      error = packFile + " has no banks in it";
+      return false;
+   }
+   return true;
+}
+
+std::string BankPack::getError(void)
+{
+   return error;
+}
+
+//Banks are done in the order listed, a bank that fails doesn't stop
+//the rest, each one is independent of the others
+//The phase times of every bank are left in the Burn for --stats
+bool BankPack::write(Burn & b)
+{
+   const std::vector<PhaseTime> & phases = b.getPhaseTimes();
+   unsigned int before;
+   long started;
+   bool ok = true;
+
+   for(unsigned int i = 0; i < banks.size(); i++)
+   {
+      PackBank & p = banks[i];
+
+      started = Timer::currentMillis();
+      before = phases.size();
+      p.ok = p.written = false;
+      p.failedAt.clear();
+
+      if(!b.setBank(p.bank))
+         p.failedAt = "no such bank";
+      else if(!b.setBinFile(p.file) || !b.readFileToBank())
+         p.failedAt = "loading";
+      else
+      {
+         p.ok = b.writeFileToBank();
+         p.written = !b.getWriteSkipped();
+         if(!p.ok)
+            p.failedAt = phases.size() > before ? phases.back().phase : "starting";
+      }
+
+      p.millis = Timer::currentMillis() - started;
+      p.done = true;
+      ok = ok && p.ok;
+   }
+   return ok;
+}
+
+std::vector<PackBank> BankPack::getBanks(void)
+{
+   return banks;
+}
+
+int BankPack::getBanksWritten(void)
+{
+   int n = 0;
+
+   for(unsigned int i = 0; i < banks.size(); i++)
+      if(banks[i].ok && banks[i].written)
+         n++;
+   return n;
+}
+
+BankPack::BankPack(void)
+{
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Several bins packed into the banks of one chip
+ *
+ * ECU switchers use each 64K bank of a 29F040 as a tune of its own.  A
+ * pack file lists which bin goes in which bank, one per line:
+ *
+ *    <bank> <file>
+ *
+ * with # starting a comment, banks that aren't listed are left alone.
+ * Each bin is placed in its bank the way it would be on a chip the size
+ * of the bank.  Writing the pack checks each bank against the chip and
+ * only erases and rewrites the ones that don't already hold their bin,
+ * see Burn::writeFileToBank, so changing one tune only costs one bank.
+ *
+ */
+#include <config.h>
+#include <string>
+#include <vector>
+
+//only written through a reference, so Burn.h is left to whoever includes this
+class Burn;
+
+//One bank of the pack and how it went once it's been written
+struct PackBank
+{
+   //line of the pack file it came from
+   int line;
+   int bank;
+   std::string file;
+
+   //filled in by write
+   bool done;
+   bool ok;
+   //false if the bank already held the bin
+   bool written;
+   long millis;
+   //what it was doing when it failed, empty if it didn't
+   std::string failedAt;
+};
+
+class BankPack
+{
+
+public:
+   //sets the pack file
+   bool setFile(std::string);
+
+   //gets the pack file
+   std::string getFile(void);
+
+   //reads and parses the pack, on failure getError says where
+   bool load(void);
+
+   //returns what was wrong with the pack the last load failed on
+   std::string getError(void);
+
+   //checks each bank in the pack against the chip in the burner passed,
+   //which has to be found and set to the chip type already, and writes
+   //the ones that differ, true only if every bank ends up holding its bin
+   bool write(Burn &);
+
+   //the banks in the order they're listed, with how they went once written
+   std::vector<PackBank> getBanks(void);
+
+   //number of banks the last write had to erase and rewrite
+   int getBanksWritten(void);
+
+   //Constructor
+   BankPack(void);
+
+private:
+   std::string packFile;
+   std::string error;
+   std::vector<PackBank> banks;
+};
@@ -35,14 +35,9 @@
  *
  * the following improvements could be used in current implementation:
  *
- * 1) At this point the EECIV stuff isn't supported very well so that
- * part of the code can use some beefing up
- *
- * 2) most of the functions should be collapsed to use the bank functions
+ * 1) most of the functions should be collapsed to use the bank functions
  * if a whole chip is being written/erased  for a AM29 chip
  *
- * 3) Better support for banking where available, with offsets into banks being calc'd
- *
  *
  *
  * Otherwise, the implementation is pretty full, everything returns a bool
@@ -70,14 +65,51 @@
  *update constructor to match model in ostrich
  *check for the getLastBlockSize
  *check for bools where calls can be put into if() s
- *change getblock to write into the bin array directly and reset the index if data OK isn't good
  *change sendblock to write directly from bin and send checksum afterwards - zero copy
  *
  */
 
 #include "Burn.h"
+#include "Kernels.h"
+#include "StreamWriter.h"
+#include "BlockPipe.h"
+#include "Timer.h"
+#include "BufferPool.h"
+#include <string.h>
+#include <sys/stat.h>
 #include <iostream>
 
+//EEC-IV banks are 64K on the chip, a 56K one in a file is missing the bottom 8K
+static const int eecBankSize = 0x10000;
+static const int eecShortBank = 0xE000;
+
+//length of each bank in an EEC-IV bin of the size passed, 0 if it isn't
+//1, 2 or 4 banks of 56K or 64K, no size is a whole number of both
+static int eecBankLength(int size)
+{
+   int n;
+
+   if(size <= 0)
+      return 0;
+   if(size % eecShortBank == 0 && ((n = size / eecShortBank) == 1 || n == 2 || n == 4))
+      return eecShortBank;
+   if(size % eecBankSize == 0 && ((n = size / eecBankSize) == 1 || n == 2 || n == 4))
+      return eecBankSize;
+   return 0;
+}
+
+//Every chip the burner knows about, ends at the NONE entry
+static const ChipTraits chipTraits[] =
+{
+   //type       name          description        size             banks addr  erase    page ops
+   { SST27SF512, "SST27SF512", "SST 27sf512",     SST27SF512_SIZE, 1,    2,    0x10000, 0,   CHIP_READ | CHIP_WRITE | CHIP_ERASE | CHIP_VERIFY | CHIP_BLANK },
+   { AM29F040,   "AM29F040",   "AMD 29f040",      AM29F040_SIZE,   8,    3,    0x10000, 0,   CHIP_READ | CHIP_WRITE | CHIP_ERASE | CHIP_VERIFY | CHIP_BLANK },
+   { EECIV,      "EECIV",      "Moates EEC 4",    EECIV_SIZE,      8,    3,    0x10000, 0,   CHIP_READ | CHIP_WRITE | CHIP_ERASE | CHIP_VERIFY | CHIP_BLANK },
+   { AT29C256,   "AT29C256",   "ATMEL 29c256",    AT29C256_SIZE,   1,    2,    0,       64,  CHIP_READ | CHIP_WRITE | CHIP_VERIFY | CHIP_BLANK },
+   { M2732A,     "M2732A",     "Microchip 2732",  M2732A_SIZE,     1,    2,    0,       0,   CHIP_READ | CHIP_VERIFY | CHIP_BLANK },
+   { NONE,       "",           "",                NONE_SIZE,       0,    0,    0,       0,   0 }
+};
+
 //This assumes that the serial port is already setup for 921.6k
 //if no device is found
 //Tries @ 115.2 and asks for the device to be bumped up
@@ -183,6 +215,38 @@ bool Burn::updateChecksum( char c)
    return true;
 }
 
+//Adds a block to the checksum, summed a vector at a time
+bool Burn::updateChecksum(const char * src, int len)
+{
+   if(len <= 0)
+      return true;
+
+   if(checksumFirstByte)
+   {
+      checksum = 0;
+      checksumFirstByte = false;
+   }
+   checksum += Kernels::checksum(src, len);
+
+   return true;
+}
+
+//Same but copies the block to dest while it's being summed
+bool Burn::copyWithChecksum(char * dest, const char * src, int len)
+{
+   if(len <= 0)
+      return true;
+
+   if(checksumFirstByte)
+   {
+      checksum = 0;
+      checksumFirstByte = false;
+   }
+   checksum += Kernels::copyChecksum(dest, src, len);
+
+   return true;
+}
+
 //reset checksum across a number of bytes
 bool Burn::resetChecksum( void )
 {
@@ -204,363 +268,1064 @@ bool Burn::resetBinIdx( void )
 
 //function to write file to chip and verify it
 //This does the erase, verify of erase, burn and verify in one shot
+//The file is opened once and loaded while the erase is running,
+//only the part of the chip the bin lands on is blank checked and verified
+//If a journal is set, the bin is loaded up front instead so an earlier
+//write of it that died part way can be picked up without an erase
+//If an image was handed over by setImage the file isn't loaded at all
+//The device is only looked for if it hasn't been found on this port yet
+//With the write cache on, a bin that was already written and verified
+//here is only spot checked
 bool Burn::writeFileToChip(void)
 {
-   return ( checkForDevice() &&
-            eraseChip() &&
-            verifyChipIsBlank() &&
-            calculateChipOffset() &&
-            readFileToMemory() &&
-            writeMemoryToChip() &&
-            verifyChipToFile() ) ;
-}
-
-
-//Verify bin on chip against the file specified by binFile
-//Must take offset into account, depends on file staying open from
-//the offset calcualtion function
-bool Burn::verifyChipToFile(void)
-{
-   char * fileOnDisk;
-   int fsize;
+   bool loaded = image != NULL && image != &fileImage;
+   int start = 0;
 
-   //Setup offset
-   if(!calculateChipOffset())
+   writeSkipped = false;
+   if(traits == NULL || !(traits->ops & CHIP_WRITE))
       return false;
 
-   //Read the chip into the bin array
-   if(!readChipToMemory())
+   if(!foundDevice && !checkForDevice())
       return false;
 
-   //Go to end of file to get length of file
-   file.seekg(0, std::ios::end);
-
-   //Get length of file
-   fsize = file.tellg();
+   if(cache.isEnabled())
+   {
+      if(!loaded && !readFileToMemory())
+         return false;
+      loaded = true;
+      if(cache.isCached(journalDevice(), image->hash()) && spotCheck())
+         return writeSkipped = true;
+   }
 
-   //allocate some memory to hold file
-   fileOnDisk = new char[fsize];
+   if(journal.isEnabled())
+   {
+      if(!loaded && !readFileToMemory())
+         return false;
+      loaded = true;
+      start = resumeAddress();
+   }
 
-   //Go to beginning of file
-   file.seekg(0, std::ios::beg);
+   //EEC-IV bins only take the banks they're laid out in and only those
+   //are erased, so it has to be loaded to know which
+   if(romType == EECIV && !loaded)
+   {
+      if(!readFileToMemory())
+         return false;
+      loaded = true;
+   }
 
-   //Suck the file into memory
-   file.read(fileOnDisk, fsize);
+   //Chips that can't be erased are programmed in place
+   if(!(traits->ops & CHIP_ERASE))
+   {
+      if(!loaded && !readFileToMemory())
+         return false;
 
-   //Walk the array based upon offsets and make sure that
-   //the bytes match up
-   for(int i = offsetOnChip; i < romSize ; i++)
-      if(fileOnDisk[i-offsetOnChip] != bin[i] )
-      {
-         delete[] fileOnDisk;
+      if(differentialWrite)
+         return ( writeMemoryToChipDifferential() &&
+                  verifyRangeToMemory(offsetOnChip, romSize) ) ;
+   }
+   //Nothing to pick up, start from a freshly erased chip
+   else if(start <= offsetOnChip)
+   {
+      if(!(romType == EECIV ? eraseImageBanks() : eraseChip(!loaded)) ||
+            !verifyRangeIsBlank(offsetOnChip, image->getEnd()))
          return false;
-      }
-   delete[] fileOnDisk;
-   return true;
-}
+   }
 
-//Verify bin on chip against the file specified by binFile
-bool Burn::verifyChipIsBlank(void)
-{
-   if(!readChipToMemory())
+   if(start < offsetOnChip)
+      start = offsetOnChip;
+
+   if(!writeMemoryToChipFrom(start) || !verifyRangeToMemory(offsetOnChip, romSize))
       return false;
 
-   for(int i = 0; i < romSize; i++)
-      if( bin[i] != (char) 0xFF)
-         return false;
+   //It's all on there and checked, nothing left to pick up
+   if(journal.isEnabled())
+      journal.clear(journalDevice());
+   if(cache.isEnabled())
+      cache.record(journalDevice(), image->hash());
 
    return true;
 }
-//Function to load file's contents to memory buffer in bin
-bool Burn::readFileToMemory(void)
+
+//Looks the bin up in the journal, if an earlier write of it to this
+//chip stopped part way the last block it recorded is read back and
+//checked, returns the address to carry on from or the offset to start over
+int Burn::resumeAddress(void)
 {
-   int fsize;
-   if(file.is_open())
-      file.close();
+   char tmp[maxHWBlockSize+1];
+   unsigned int check;
+   int addr;
+   bool ok;
+
+   addr = journal.getResumeAddress(journalDevice(), image->hash());
+   if(addr <= offsetOnChip || addr > (int) romSize)
+      return offsetOnChip;
+
+   //blocks never span a gap, so the last one recorded is read back
+   //from no further down than the start of the extent it ends in
+   if(!image->covers(addr - 1))
+      return offsetOnChip;
+   check = addr - blockSize < offsetOnChip ? offsetOnChip : addr - blockSize;
+   while(!image->covers(check))
+      check++;
+   transferEnd = addr;
+   ok = readBlock(check, tmp) &&
+        Kernels::isEqual(tmp, image->at(check), transferSize());
+   transferEnd = romSize;
+
+   return ok ? addr : offsetOnChip;
+}
 
-   file.open(binFile.c_str() , std::ios::in | std::ios::ate | std::ios::binary);
-   //if there was an error opening it or the size is larger than the rom, bail
-   if( (!file.is_open() ) || file.tellg() > romSize )
-      return false;
-   fsize = file.tellg();
+//name this burner and chip type go by in the journal
+std::string Burn::journalDevice(void)
+{
+   return std::string("burn:") + comPort + ":" + (char) romType;
+}
 
-   //go back to beginning
-   file.seekg(0);
+//Banks have names of their own, the whole chip's name mustn't be the
+//start of them or dropping it would take every bank with it
+std::string Burn::bankDevice(int b)
+{
+   std::string s = std::string("bank:") + comPort + ":" + (char) romType + ":";
 
-   return file.read(bin, fsize);
+   if(b >= 0)
+      s += (char) ('0' + b);
+   return s;
 }
 
-//This will dump the current memory buffer to disk based upon
-//selected chip's size
-bool Burn::writeMemoryToFile(void)
+//The whole chip overlaps every bank, so anything done to it drops them all
+//and anything done to a bank drops the whole chip
+void Burn::dropCached(int b)
 {
-   if(file.is_open())
-      file.close();
+   cache.clear(journalDevice());
+   cache.clear(bankDevice(b));
+}
 
-   file.open(binFile.c_str(), std::ios::out | std::ios::binary);
-   //if there was an error opening the file, bail
-   if( !file.is_open() )
-      return false;
+int Burn::bankHolding(unsigned int start, unsigned int end)
+{
+   int sz = bankSize();
 
-   return file.write(bin, romSize);
+   if(sz <= 0 || end <= start || start / sz != (end - 1) / sz)
+      return -1;
+   return start / sz;
 }
 
-//Writes a bin to the selected chip from filename specified by binFile
-//This assumes the chip is blank and has been verified as such
-bool Burn::writeMemoryToChip(void)
+int Burn::bankOf(unsigned int addr)
 {
-   unsigned int i;
-   //reset current chunk of bin to start and setup the offset
+   return bankSize() > 0 ? addr / bankSize() : 0;
+}
 
-   if( !resetBinIdx())
-   {
-      //std::cerr << "resetBinIdx failed" << std::endl;
-      return false;
-   }
-   if( !calculateChipOffset())
-   {
-      //std::cerr << "calcualteChipOffset failed" << std::endl;
+//Only the banks the image has data in, one erase each
+bool Burn::eraseImageBanks(void)
+{
+   if(image == NULL || image->isEmpty())
       return false;
-   }
-   //Walk through bin sending chunks of the specified
-   //block size
-   for( i = offsetOnChip; i < romSize; i+=blockSize)
-   {
-      if(! buildCommand( 'W', (unsigned char * ) &i, i/(maxBinSize/banks) ))
-      {
-         //std::cerr << "buildcommand failed" << std::endl;
-         return false;
-      }
-      if(!sendCommands() )
-      {
-         //std::cerr << "sendCommands failed" << std::endl;
-         return false;
-      }
-      if(!sendDataBlock())
-      {
-         //std::cerr << "sendDataBlock failed" << std::endl;
+
+   for(int b = bankOf(image->getStart()); b <= bankOf(image->getEnd() - 1); b++)
+      if(!eraseBankAndWait(b))
          return false;
-      }
-   }
-   //Check to see if we wrote the whole thing out
-   if( i >= romSize)
-      return true;
-   else
-      return false;
+   return true;
+}
 
+int Burn::bankSize(void)
+{
+   if(traits == NULL || traits->banks <= 0)
+      return 0;
+   return romSize / traits->banks;
 }
 
-//reads a bin from the chip to the filename specified by binFile
-bool Burn::readChipToMemory(void)
+//Samples are spread evenly over the data in the bin, a block each
+bool Burn::spotCheck(void)
 {
-   char tmp[blockSize+1];
-   unsigned int i;
+   char tmp[maxHWBlockSize+1];
+   Extent r;
+   bool ok = true;
 
-   //reset the index so reads will start at 0
-   resetBinIdx();
-   //loop counter is used as address counter too
-   //it's read in parts by the cp pointer
-   //Bank will always be 0 for small chips and ignored by build command
-   for( i = 0; i < romSize ; i+=blockSize)
+   for(int i = 0; ok && i < cacheSamples; i++)
    {
-      if(! buildCommand( 'R', (unsigned char *) &i, i/(maxBinSize/banks)) )
-      {
-         //std::cerr << "resetChecksum failed" << std::endl;
-         return false;
-      }
-      if(! serial.purgeRX() )
-      {
-         //std::cerr << "purgeRX failed" << std::endl;
-         return false;
-      }
-      if(! sendCommands() )
-      {
-         //std::cerr << "sendCommands failed" << std::endl;
-         return false;
-      }
+      if(!image->sample(i, cacheSamples, blockSize, r))
+         break;
 
-      if(! getDataBlock() )
-      {
-         //std::cerr << "getdatablock failed with '?', retrying" << std::endl;
-         return false;
-      }
+      transferEnd = r.end;
+      ok = readBlock(r.start, tmp) &&
+           Kernels::isEqual(tmp, image->at(r.start), transferSize());
+      transferEnd = romSize;
    }
+   return ok;
+}
 
-   //Check to see if we read the whole bin
-   if( i >= romSize)
-      return true;
-   else
+//Verify the chip against the bin already in memory, only the parts
+//of the range the image has extents for are read, a block at a time
+bool Burn::verifyRangeToMemory(unsigned int start, unsigned int end)
+{
+   unsigned int from, to;
+   long done = 0;
+
+   mismatches.clear();
+
+   if(image == NULL || image->isEmpty() || image->getEnd() > (int) romSize)
       return false;
+
+   meter.start("verify", image->getDataLength(start, end), retryCount);
+
+   const std::vector<Extent> & extents = image->getExtents();
+   for(unsigned int e = 0; e < extents.size(); e++)
+   {
+      from = (int) start > extents[e].start ? start : extents[e].start;
+      to = (int) end < extents[e].end ? end : extents[e].end;
+
+      if(from < to && !verifyBlocks(from, to, image->at(from), done))
+         return false;
+   }
+   return true;
 }
 
-bool Burn::buildCommand( char c, unsigned char * address, int bank)
+//Stops at the first block that doesn't match and records where
+bool Burn::verifyBlocks(unsigned int from, unsigned int to, const char * want, long & done)
 {
-   if(romSize)
-   {
-      command[0] = romType;
-      command[1] = c;
-      switch(c)
-      {
-      case 'R':
-      case 'W':
-         //make sure block size is sane
-         if(blockSize > maxHWBlockSize)
-         {
-            command[0] = EOF;
-            return false;
-         }
+   char tmp[maxHWBlockSize+1];
+   unsigned int i;
+   int sz;
+   bool ok = true;
 
-         //This attempts to hit the last byte written to the rom
-         //If we call with a block that would end up being past it's last
-         //address, allows read/write functions to be sloppy
-         //It seems like it works, but it's frigging ugly as sin
-         //Should be rewritten in a more clear fashion, would proabaly cause a bus error on big endian box
-         if( romSize -  ( * ((int * ) address)  ) < blockSize  )
-         {
-            setLastBlockSize((unsigned char ) (romSize - ( * ((int * ) address) )));
-            command[2] = getLastBlockSize();
-            //std::cerr << "setting requested number of bytes to: " << std::dec << command[2] << std::endl;
-         }
-         else if(blockSize == maxHWBlockSize)
-         {
-            command[2] = 0x00;
-            setLastBlockSize(0x00);
-         }
-         else
-         {
-            command[2] = blockSize;
-            setLastBlockSize(blockSize);
-         }
-         //Make sure 3rd address byte is taken into account for
-         //large chips
-         if(romType == EECIV || romType == AM29F040 )
-         {
-            command[3] = bank;
-            command[4] = address[1];
-            command[5] = address[0];
-            command[6] = EOF;
-         }
-         else
-         {
-            command[3] = address[1];
-            command[4] = address[0];
-            command[5] = EOF;
-         }
+   //blocks stop at the end of the range
+   transferEnd = to;
+   for(i = from; ok && i < to; i += sz)
+   {
+      if(!(ok = readBlock(i, tmp)))
          break;
 
-         //Only allow erases on the EEC/AMD/SST chips
-      case 'E':
-         if(romType== EECIV || romType == AM29F040)
-         {
-            command[2] = bank;
-            command[3] = EOF;
-         }
-         else if(romType == SST27SF512)
-            command[2] = EOF;
-         else
-            return false;
-
+      sz = transferSize();
+      if(!(ok = Kernels::isEqual(tmp, want + (i - from), sz)))
+      {
+         recordMismatches(i, tmp, want + (i - from), sz);
          break;
       }
-      return true;
+      done += sz;
+      ok = meter.update(done, i, retryCount);
    }
-   return false;
+   transferEnd = romSize;
+
+   return ok;
 }
-//Erase the chip, docs say it takes 1/2 sec
-//So, we sleep a whole second before checking the
-//return clode
-bool Burn::eraseChip(void)
+
+//Verify the chip is blank between the addresses, a block at a time
+//leaves bin[] alone so it can hold a bin waiting to be written
+bool Burn::verifyRangeIsBlank(unsigned int start, unsigned int end)
 {
-   bool status = true;
-   char tmp = 0;
+   char tmp[maxHWBlockSize+1];
+   unsigned int i;
+   int sz;
 
-   if( ! serial.purgeRX() )
-      return false;
+   mismatches.clear();
+   meter.start("blank check", end - start, retryCount);
 
-   if(romType == EECIV || romType == AM29F040 )
-   {
-      for(int i = 0; i < banks && status; i++)
-      {
-         if(!eraseBank(i))
-         {
-            return false;
-         }
-#ifdef WIN32
-         Sleep(1000);
-#else
-         sleep(1);
-#endif
-         if(!serial.getByte(&tmp))
-         {
-            return false;
-         }
-         if(tmp != dataOK)
-         {
-            return false;
-         }
-      }
-      return true;
-   }
-   else if(romType == SST27SF512)
+   for(i = start; i < end; i += sz)
    {
-      if(! buildCommand('E', NULL, 0) )
-      {
+      if(!readBlock(i, tmp))
          return false;
-      }
-      if(! sendCommands() )
+
+      sz = transferSize();
+      if(!Kernels::isBlank(tmp, sz))
       {
+         recordMismatches(i, tmp, NULL, sz);
          return false;
       }
-#ifdef WIN32
-      Sleep(1000);
-#else
-      sleep(1);
-#endif
-      if(!serial.getByte(&tmp))
-      {
+      if(!meter.update(i + sz - start, i, retryCount))
          return false;
-      }
-      if(tmp == dataOK)
-      {
-         return true;
-      }
    }
-   return false;
-
+   return true;
 }
 
-//Erase bank, only good for 29f040 chips, will return error if other chips selected
-bool Burn::eraseBank( int i )
+//reads the block starting at addr into dest
+//Bank will always be 0 for small chips and ignored by build command
+bool Burn::readBlock(unsigned int addr, char * dest)
 {
-   if((romType == EECIV || romType == AM29F040)  &&  i >= 0 && i < banks)
-      return ( buildCommand('E', NULL, i) && sendCommands() );
+   for(int attempt = 0; ; attempt++)
+   {
+      if( buildCommand('R', (unsigned char *) &addr, bankOf(addr)) &&
+            serial.purgeRX() &&
+            sendCommands() &&
+            getDataBlock(dest) )
+         return true;
 
-   else
-      return false;
+      if(!retryBlock(attempt))
+         return false;
+   }
 }
 
-//Calcuate offset of binary on chip, based upon file size
-bool Burn::calculateChipOffset(void)
+//Called after a block fails, returns false once it's out of retries
+//otherwise waits, doubling the wait each time, and clears out anything
+//left in the port from the failed attempt so the block can be tried again
+bool Burn::retryBlock(int attempt)
 {
-   if(file.is_open())
-      file.close();
-
-   file.open(binFile.c_str() , std::ios::in | std::ios::ate | std::ios::binary);
-   if(!file.is_open())
+   if(attempt >= maxRetries)
       return false;
 
-   offsetOnChip = (int) romSize - (int) file.tellg();
+   if(attempt == 0)
+      blocksRetried++;
+   retryCount++;
 
-   if(offsetOnChip >= romSize || offsetOnChip < 0 )
-   {
-      offsetOnChip = 0;
-      return  false;
-   }
-   else
-      return true;
+   Timer::sleepMillis((long) retryDelay << attempt);
+   serial.purgeRX();
+   return true;
 }
 
-int Burn::getOffset(void)
+//Verify bin on chip against the file specified by binFile
+//The file is loaded once and each block read from the chip is compared
+//as it comes in, so a bad chip is caught without reading the rest of it
+bool Burn::verifyChipToFile(void)
+{
+   mismatches.clear();
+
+   return ( readFileToMemory() &&
+            verifyRangeToMemory(offsetOnChip, romSize) );
+}
+
+//Verify bin on chip is blank, stops at the first block that isn't
+bool Burn::verifyChipIsBlank(void)
+{
+   return verifyRangeIsBlank(0, romSize);
+}
+
+std::vector<MismatchRange> Burn::getMismatches(void)
+{
+   return mismatches;
+}
+
+std::vector<Extent> Burn::getExtents(void)
+{
+   if(image == NULL)
+      return std::vector<Extent>();
+   return image->getExtents();
+}
+
+//Walks the block and records each run of bytes that differ from
+//expected, if expected is NULL the chip should have been blank
+void Burn::recordMismatches(unsigned int addr, const char * got, const char * expected, int sz)
+{
+   MismatchRange r;
+   int i = 0;
+
+   while(i < sz)
+   {
+      //skip to the next bad byte
+      if(expected)
+         i += Kernels::firstDifference(got + i, expected + i, sz - i);
+      else
+         i += Kernels::firstNonBlank(got + i, sz - i);
+
+      if(i >= sz)
+         break;
+
+      r.start = addr + i;
+      while(i < sz && got[i] != (expected ? expected[i] : (char) 0xFF))
+         i++;
+      r.end = addr + i;
+      mismatches.push_back(r);
+   }
+}
+
+//Function to load file's contents into the image
+//The offset on chip is worked out from the same open of the file
+//so there's no need to call calculateChipOffset first
+//Raw EEC-IV bins are laid out a bank at a time, see Burn.h
+bool Burn::readFileToMemory(void)
+{
+   image = &fileImage;
+   if(!loadImage(fileImage, binFile, romType))
+   {
+      offsetOnChip = 0;
+      return false;
+   }
+
+   offsetOnChip = fileImage.getStart();
+   return true;
+}
+
+//EEC-IV bins are tried as banks first, from the size alone, loadBanks
+//turns the file down without reading it if it's really HEX or S-records
+bool Burn::loadImage(Image & img, std::string file, ChipType ct)
+{
+   const ChipTraits * t = getChipTraits(ct);
+   struct stat st;
+   int len = 0;
+
+   if(t == NULL)
+      return false;
+   if(ct == EECIV && stat(file.c_str(), &st) == 0)
+      len = eecBankLength((int) st.st_size);
+   if(len && (img.loadBanks(file, len, eecBankSize) || img.getFormat() == RAW_BINARY))
+      return !img.isEmpty();
+   return img.load(file, t->size);
+}
+
+//Uses the image passed as the bin instead of loading binFile, nothing
+//is copied so it has to stay put until this is done with it, which lets
+//several burners share one image
+bool Burn::setImage(const Image * img)
+{
+   if(img == NULL || img->isEmpty() || img->getEnd() > (int) romSize)
+      return false;
+
+   image = img;
+   offsetOnChip = img->getStart();
+   return true;
+}
+
+//This will dump the current memory buffer to disk based upon
+//selected chip's size
+bool Burn::writeMemoryToFile(void)
+{
+   if(file.is_open())
+      file.close();
+
+   file.open(binFile.c_str(), std::ios::out | std::ios::binary);
+   //if there was an error opening the file, bail
+   if( !file.is_open() || bin == NULL || binSize < romSize )
+      return false;
+
+   return file.write(bin, romSize);
+}
+
+bool Burn::readChipToFile(void)
+{
+   return readRangeToFile(0, romSize);
+}
+
+bool Burn::readBankToFile(void)
+{
+   if(bankSize() <= 0)
+      return false;
+   return readRangeToFile(currentBank * bankSize(), (currentBank + 1) * bankSize());
+}
+
+//Streams the range to the bin file, "-" for stdout, the writer thread
+//saves each block while the next one is read, so output starts straight
+//away and only a few blocks are ever held, a file that doesn't get the
+//whole range is removed
+bool Burn::readRangeToFile(unsigned int start, unsigned int end)
+{
+   StreamWriter out;
+   char * slot;
+   unsigned int i;
+   int sz = 0;
+
+   //blocks come back with their checksum on the end
+   if(!out.open(binFile, maxHWBlockSize + 1))
+      return false;
+
+   meter.start("read", end - start, retryCount);
+   transferEnd = end;
+   for(i = start; i < end; i += sz)
+   {
+      if((slot = out.getSlot()) == NULL ||
+            !readBlock(i, slot) ||
+            !out.commit(sz = transferSize()) ||
+            !meter.update(i + sz - start, i, retryCount))
+      {
+         transferEnd = romSize;
+         out.abort();
+         return false;
+      }
+   }
+   transferEnd = romSize;
+   return out.close();
+}
+
+//The block and its checksum are read straight into the pipe's buffer,
+//the checksum lands on the start of the next block, which the other
+//end can't be looking at yet
+bool Burn::readChipToPipe(BlockPipe & pipe)
+{
+   unsigned int i;
+   int sz = 0;
+   bool ok = pipe.getBuffer() != NULL && pipe.getSize() == (int) romSize;
+
+   meter.start("read", romSize, retryCount);
+   for(i = 0; ok && i < romSize; i += sz)
+      ok = readBlock(i, pipe.getBuffer() + i) &&
+           pipe.fill(i + (sz = transferSize())) &&
+           meter.update(i + sz, i, retryCount);
+
+   if(!ok)
+      pipe.fail();
+   return ok;
+}
+
+//The erase and blank check run while the other end is already reading,
+//so by the time they're done there are blocks waiting, after that each
+//write only waits on the read of the block it sends
+bool Burn::writePipeToChip(BlockPipe & pipe)
+{
+   const char * src = pipe.getBuffer();
+   unsigned int i;
+   int sz = 0;
+   long done = 0;
+   bool ok;
+
+   mismatches.clear();
+   ok = traits != NULL && (traits->ops & CHIP_WRITE) &&
+        src != NULL && pipe.getSize() == (int) romSize;
+
+   if(ok && (traits->ops & CHIP_ERASE))
+      ok = eraseChip() && verifyChipIsBlank();
+
+   //whatever was cached isn't what's going on the chip
+   dropCached(-1);
+
+   if(ok)
+      meter.start("write", romSize, retryCount);
+   for(i = 0; ok && i < romSize; i += sz)
+   {
+      sz = romSize - i < (unsigned int) blockSize ? romSize - i : blockSize;
+      ok = pipe.waitFor(i + sz) &&
+           writeBlock(i, src + i, sz) &&
+           meter.update(i + sz, i, retryCount);
+   }
+
+   if(ok)
+   {
+      meter.start("verify", romSize, retryCount);
+      ok = verifyBlocks(0, romSize, src, done);
+   }
+
+   if(!ok)
+      pipe.fail();
+   return ok;
+}
+
+//Writes a bin to the selected chip from filename specified by binFile
+//This assumes the chip is blank and has been verified as such
+//and the bin has been loaded, and it's offset set, by readFileToMemory
+//If a journal is set, a write of the same bin that died part way
+//is picked up from the last block it recorded
+bool Burn::writeMemoryToChip(void)
+{
+   if( image == NULL || image->isEmpty() || image->getEnd() > (int) romSize )
+   {
+      //std::cerr << "no bin loaded for this chip" << std::endl;
+      return false;
+   }
+
+   if(journal.isEnabled())
+      return writeMemoryToChipFrom(resumeAddress());
+
+   return writeMemoryToChipFrom(offsetOnChip);
+}
+
+//Writes the extents of the bin from the chip address passed up to the
+//end of the chip, blocks stop at the end of each extent so nothing in
+//the gaps goes out, with a journal set, progress is recorded every
+//journalInterval blocks and where it got to if a block fails
+bool Burn::writeMemoryToChipFrom(unsigned int start)
+{
+   unsigned int i, from;
+   int blocks = 0;
+   int attempt;
+   long done = 0;
+   std::string hash;
+
+   if( image == NULL || image->isEmpty() || image->getEnd() > (int) romSize || (int) start < offsetOnChip )
+   {
+      //std::cerr << "no bin loaded for this chip" << std::endl;
+      return false;
+   }
+
+   if(journal.isEnabled())
+      hash = image->hash();
+
+   //a write that dies part way mustn't look cached
+   dropCached(bankHolding(start, image->getEnd()));
+
+   meter.start("write", image->getDataLength(start, romSize), retryCount);
+
+   const std::vector<Extent> & extents = image->getExtents();
+   for(unsigned int e = 0; e < extents.size(); e++)
+   {
+      if(extents[e].end <= (int) start)
+         continue;
+      from = extents[e].start > (int) start ? extents[e].start : start;
+
+      //Walk through the extent sending chunks of the specified block
+      //size, a block that fails is sent again until it's out of retries
+      transferEnd = extents[e].end;
+      for( i = from; (int) i < extents[e].end; i+=blockSize)
+      {
+         for(attempt = 0; !( buildCommand( 'W', (unsigned char * ) &i, bankOf(i) ) &&
+                             sendCommands() &&
+                             sendDataBlock(image->at(i)) ); attempt++)
+         {
+            if(!retryBlock(attempt))
+            {
+               //std::cerr << "sendDataBlock failed" << std::endl;
+               transferEnd = romSize;
+               if(journal.isEnabled() && i > start)
+                  journal.record(journalDevice(), hash, i);
+               return false;
+            }
+         }
+         if(journal.isEnabled() && ++blocks % journalInterval == 0)
+            journal.record(journalDevice(), hash, i + transferSize());
+         done += transferSize();
+         //a write that's stopped can be picked up again like one that died
+         if(!meter.update(done, i, retryCount))
+         {
+            transferEnd = romSize;
+            if(journal.isEnabled())
+               journal.record(journalDevice(), hash, i + transferSize());
+            return false;
+         }
+      }
+      transferEnd = romSize;
+   }
+   return true;
+}
+
+//Reads the chip a block at a time and rewrites only the pages
+//that differ from the bin in memory, runs of changed pages go out
+//in a single write, bytes outside the extents are written back as read
+//so pages are always written whole
+bool Burn::writeMemoryToChipDifferential(void)
+{
+   char got[maxHWBlockSize+1];
+   char want[maxHWBlockSize];
+   unsigned int i, first;
+   int j, sz, page, end, pageSize;
+
+   pagesWritten = 0;
+
+   //Anything that needs an erase can't be programmed over itself
+   //and it only works on chips that are written a page at a time
+   if(traits == NULL || (traits->ops & CHIP_ERASE) || traits->pageSize <= 0)
+      return false;
+   pageSize = traits->pageSize;
+
+   if( image == NULL || image->isEmpty() || image->getEnd() > (int) romSize )
+      return false;
+
+   //blocks have to line up with pages for the diff to work
+   if( blockSize % pageSize )
+      return writeMemoryToChip();
+
+   dropCached(-1);
+
+   //progress goes by how much of the chip has been compared
+   first = offsetOnChip - offsetOnChip % pageSize;
+   meter.start("write", romSize - first, retryCount);
+
+   for(i = first; i < romSize; i += sz)
+   {
+      if(!readBlock(i, got))
+         return false;
+
+      sz = transferSize();
+      for(j = 0; j < sz; j++)
+         want[j] = image->covers(i + j) ? *image->at(i + j) : got[j];
+
+      for(page = 0; page < sz; page = end)
+      {
+         end = page + pageSize < sz ? page + pageSize : sz;
+         if(Kernels::isEqual(got + page, want + page, end - page))
+            continue;
+
+         //pull any following changed pages into the same write
+         pagesWritten++;
+         while(end < sz && !Kernels::isEqual(got + end, want + end, (end + pageSize < sz ? pageSize : sz - end)))
+         {
+            end = end + pageSize < sz ? end + pageSize : sz;
+            pagesWritten++;
+         }
+
+         if(!writeBlock(i + page, want + page, end - page))
+            return false;
+      }
+      if(!meter.update(i + sz - first, i, retryCount))
+         return false;
+   }
+   return true;
+}
+
+//writes len bytes from src to the chip at addr
+bool Burn::writeBlock(unsigned int addr, const char * src, int len)
+{
+   bool ok;
+
+   transferEnd = addr + len;
+   for(int attempt = 0; !(ok = ( buildCommand('W', (unsigned char *) &addr, bankOf(addr)) &&
+                                 sendCommands() &&
+                                 sendDataBlock(src) )); attempt++)
+      if(!retryBlock(attempt))
+         break;
+   transferEnd = romSize;
+
+   return ok;
+}
+
+bool Burn::setDifferentialWrite(bool b)
+{
+   differentialWrite = b;
+   return true;
+}
+
+bool Burn::getDifferentialWrite(void)
+{
+   return differentialWrite;
+}
+
+int Burn::getPagesWritten(void)
+{
+   return pagesWritten;
+}
+
+//reads a bin from the chip to the filename specified by binFile
+bool Burn::readChipToMemory(void)
+{
+   unsigned int i;
+   int attempt;
+
+   //the last block's checksum lands past the end of the chip
+   if(!reserveBin(romSize + 1))
+      return false;
+
+   //reset the index so reads will start at 0
+   resetBinIdx();
+   meter.start("read", romSize, retryCount);
+   //loop counter is used as address counter too
+   //it's read in parts by the cp pointer
+   //Bank will always be 0 for small chips and ignored by build command
+   for( i = 0; i < romSize ; i+=blockSize)
+   {
+      //getDataBlock leaves binIdx alone on a failure so the
+      //same block is just asked for again
+      for(attempt = 0; !( buildCommand( 'R', (unsigned char *) &i, bankOf(i)) &&
+                          serial.purgeRX() &&
+                          sendCommands() &&
+                          getDataBlock() ); attempt++)
+      {
+         if(!retryBlock(attempt))
+         {
+            //std::cerr << "getdatablock failed, out of retries" << std::endl;
+            return false;
+         }
+      }
+      if(!meter.update(i + transferSize(), i, retryCount))
+         return false;
+   }
+
+   //Check to see if we read the whole bin
+   if( i >= romSize)
+      return true;
+   else
+      return false;
+}
+
+bool Burn::buildCommand( char c, unsigned char * address, int bank)
+{
+   if(traits != NULL)
+   {
+      command[0] = romType;
+      command[1] = c;
+      switch(c)
+      {
+      case 'R':
+      case 'W':
+         //make sure block size is sane
+         if(blockSize > maxHWBlockSize)
+         {
+            command[0] = EOF;
+            return false;
+         }
+
+         //This attempts to hit the last byte written to the rom
+         //If we call with a block that would end up being past it's last
+         //address, allows read/write functions to be sloppy
+         //It seems like it works, but it's frigging ugly as sin
+         //Should be rewritten in a more clear fashion, would proabaly cause a bus error on big endian box
+         if( transferEnd -  ( * ((int * ) address)  ) < blockSize  )
+         {
+            setLastBlockSize((unsigned char ) (transferEnd - ( * ((int * ) address) )));
+            command[2] = getLastBlockSize();
+            //std::cerr << "setting requested number of bytes to: " << std::dec << command[2] << std::endl;
+         }
+         else if(blockSize == maxHWBlockSize)
+         {
+            command[2] = 0x00;
+            setLastBlockSize(0x00);
+         }
+         else
+         {
+            command[2] = blockSize;
+            setLastBlockSize(blockSize);
+         }
+         //Large chips take the bank as a 3rd address byte in front, the
+         //layout comes from the traits so it's the same steps for every chip
+         command[3] = bank;
+         command[addressIdx] = address[1];
+         command[addressIdx+1] = address[0];
+         command[addressIdx+2] = EOF;
+         break;
+
+         //Only allow erases on chips that can be, banked ones take the bank
+      case 'E':
+         if(!traits->eraseSize)
+            return false;
+
+         command[2] = bank;
+         command[traits->eraseSize < romSize ? 3 : 2] = EOF;
+         break;
+      }
+      return true;
+   }
+   return false;
+}
+//Erase the chip, docs say it takes 1/2 sec
+//So, we sleep a whole second before checking the
+//return clode
+bool Burn::eraseChip(void)
+{
+   return eraseChip(false);
+}
+
+//If loadFile is set the bin is read in from disk during the first
+//wait on the hardware, the time it takes comes off of the sleep
+bool Burn::eraseChip(bool loadFile)
+{
+   bool status = true;
+   long started;
+
+   if( ! serial.purgeRX() )
+      return false;
+
+   if(traits == NULL || !traits->eraseSize)
+      return false;
+
+   //whatever was cached isn't on the chip any more
+   dropCached(-1);
+
+   meter.start("erase", romSize, retryCount);
+
+   //Chips erased a bank at a time get an erase per bank
+   if(traits->eraseSize < romSize)
+   {
+      for(int i = 0; i < romSize / traits->eraseSize && status; i++)
+      {
+         if(!startErase(i))
+            return false;
+
+         started = Timer::currentMillis();
+         if(loadFile && i == 0)
+            status = readFileToMemory();
+
+         if(!eraseDone(started))
+            return false;
+         if(!meter.update((i + 1) * traits->eraseSize, i * traits->eraseSize, retryCount))
+            return false;
+      }
+      return status;
+   }
+
+   if(!startErase(0))
+      return false;
+
+   started = Timer::currentMillis();
+   if(loadFile)
+      status = readFileToMemory();
+
+   return eraseDone(started) && meter.update(romSize, 0, retryCount) && status;
+}
+
+//Erase bank, only good for 29f040 chips, will return error if other chips selected
+bool Burn::eraseBank( int i )
+{
+   if(traits == NULL || !traits->eraseSize || traits->eraseSize >= romSize ||
+         i < 0 || i >= romSize / traits->eraseSize || !serial.purgeRX())
+      return false;
+
+   dropCached(i);
+   return startErase(i);
+}
+
+bool Burn::eraseBankAndWait(int i)
+{
+   long started = Timer::currentMillis();
+
+   if(!eraseBank(i))
+      return false;
+
+   meter.start("erase", traits->eraseSize, retryCount);
+   return eraseDone(started) &&
+          meter.update(traits->eraseSize, i * traits->eraseSize, retryCount);
+}
+
+bool Burn::startErase(int i)
+{
+   return buildCommand('E', NULL, i) && sendCommands();
+}
+
+//docs say it takes 1/2 sec, so a whole second goes by before the
+//return code is looked at
+bool Burn::eraseDone(long started)
+{
+   char tmp = 0;
+
+   Timer::sleepRemaining(started, eraseDelay);
+   return serial.getByte(&tmp) && tmp == dataOK;
+}
+
+//Calcuate offset of binary into the current bank, based upon file size
+bool Burn::calculateBankOffset(void)
+{
+   int off = Image::place(binFile, bankSize());
+
+   if(traits == NULL || off < 0)
+   {
+      offsetOnChip = 0;
+      return false;
+   }
+   offsetOnChip = currentBank * bankSize() + off;
+   return true;
+}
+
+bool Burn::setBank(unsigned int b)
+{
+   if(traits == NULL || b >= (unsigned int) traits->banks)
+      return false;
+
+   currentBank = b;
+   return true;
+}
+
+unsigned int Burn::getBank(void)
+{
+   return currentBank;
+}
+
+//The bin is placed in the bank the way it would be on a chip the size
+//of the bank, HEX and S-records give addresses from the start of the bank
+bool Burn::readFileToBank(void)
+{
+   image = &fileImage;
+   if(bankSize() <= 0 || !fileImage.load(binFile, bankSize(), currentBank * bankSize()))
+   {
+      offsetOnChip = 0;
+      return false;
+   }
+
+   offsetOnChip = fileImage.getStart();
+   return true;
+}
+
+bool Burn::verifyBankIsBlank(void)
+{
+   if(bankSize() <= 0)
+      return false;
+   return verifyRangeIsBlank(currentBank * bankSize(), (currentBank + 1) * bankSize());
+}
+
+bool Burn::writeMemoryToBank(void)
+{
+   if(image == NULL || image->isEmpty() ||
+         bankHolding(image->getStart(), image->getEnd()) != (int) currentBank)
+      return false;
+
+   return writeMemoryToChipFrom(offsetOnChip);
+}
+
+//Only the extents of the bin are read back, like verifyChipToFile
+bool Burn::verifyBankToFile(void)
+{
+   mismatches.clear();
+
+   return ( readFileToBank() &&
+            verifyRangeToMemory(currentBank * bankSize(), (currentBank + 1) * bankSize()) );
+}
+
+//A bank that already holds the bin is left alone.  With the write cache on
+//a bin it says is in the bank is only spot checked, otherwise the bank is
+//read and compared, which stops at the first block that's different, so a
+//bank that needs writing costs next to nothing to find
+bool Burn::writeFileToBank(void)
+{
+   unsigned int start, end;
+
+   writeSkipped = false;
+   if(traits == NULL || !(traits->ops & CHIP_WRITE) ||
+         traits->banks < 2 || traits->eraseSize != bankSize())
+      return false;
+
+   if(!foundDevice && !checkForDevice())
+      return false;
+
+   if(!readFileToBank())
+      return false;
+
+   start = currentBank * bankSize();
+   end = start + bankSize();
+
+   if(cache.isEnabled() && cache.isCached(bankDevice(currentBank), image->hash()) && spotCheck())
+      return writeSkipped = true;
+
+   if(bankMatches())
+      writeSkipped = true;
+   else if(!eraseBankAndWait(currentBank) ||
+           !verifyRangeIsBlank(start, end) ||
+           !writeMemoryToBank() ||
+           !verifyRangeToMemory(start, end))
+      return false;
+
+   if(cache.isEnabled())
+      cache.record(bankDevice(currentBank), image->hash());
+   return true;
+}
+
+//What's expected is laid out in bin, the bin's bytes where it has them
+//and blank everywhere else, as if the bank had just been written
+bool Burn::bankMatches(void)
+{
+   unsigned int start = currentBank * bankSize();
+   long done = 0;
+   bool same;
+
+   if(image == NULL || image->isEmpty() || !reserveBin(bankSize() + 1))
+      return false;
+
+   memset(bin, 0xFF, bankSize());
+   const std::vector<Extent> & extents = image->getExtents();
+   for(unsigned int e = 0; e < extents.size(); e++)
+      memcpy(bin + extents[e].start - start, image->at(extents[e].start), extents[e].end - extents[e].start);
+
+   meter.start("compare", bankSize(), retryCount);
+   same = verifyBlocks(start, start + bankSize(), bin, done);
+
+   //a difference isn't a failure here
+   mismatches.clear();
+   return same;
+}
+
+//Calcuate offset of binary on chip, based upon file size
+//HEX and S-records are placed by their own addresses
+bool Burn::calculateChipOffset(void)
+{
+   int len = romType == EECIV ? eecBankLength(Image::rawSize(binFile)) : 0;
+
+   //EEC-IV bins start in bank 0
+   if(len)
+   {
+      offsetOnChip = eecBankSize - len;
+      return true;
+   }
+
+   offsetOnChip = Image::place(binFile, romSize);
+   if(offsetOnChip < 0)
+   {
+      offsetOnChip = 0;
+      return false;
+   }
+   return true;
+}
+
+int Burn::getOffset(void)
 {
    return offsetOnChip;
 }
@@ -569,23 +1334,52 @@ int Burn::getOffset(void)
 //automatically adjusts size
 bool Burn::setChipType(ChipType ct)
 {
-   romType = ct;
-   if(romType == NONE) romSize = NONE_SIZE;
-   else if(romType == AT29C256) romSize = AT29C256_SIZE;
-   else if(romType == M2732A) romSize = M2732A_SIZE;
-   else if(romType == AM29F040) romSize = AM29F040_SIZE;
-   else if(romType == SST27SF512) romSize = SST27SF512_SIZE;
-   else if(romType == EECIV) romSize = EECIV_SIZE;
+   traits = getChipTraits(ct);
+   if(traits != NULL)
+   {
+      romType = ct;
+      romSize = traits->size;
+      addressIdx = traits->addressBytes > 2 ? 4 : 3;
+      if(currentBank >= (unsigned int) traits->banks)
+         currentBank = 0;
+   }
    //if we cant set the size for this type, bomb
    else
    {
       romType = NONE;
-      return false;
+      romSize = NONE_SIZE;
+      if(ct != NONE)
+         return false;
    }
 
+   transferEnd = romSize;
    return true;
 }
 
+const ChipTraits * Burn::getChipTraits(ChipType ct)
+{
+   for(int i = 0; chipTraits[i].type != NONE; i++)
+      if(chipTraits[i].type == ct)
+         return &chipTraits[i];
+   return NULL;
+}
+
+const ChipTraits * Burn::getChipTraits(std::string name)
+{
+   for(int i = 0; chipTraits[i].type != NONE; i++)
+      if(name == chipTraits[i].name)
+         return &chipTraits[i];
+   return NULL;
+}
+
+const ChipTraits * Burn::getChipTraitsAt(int n)
+{
+   for(int i = 0; chipTraits[i].type != NONE; i++)
+      if(i == n)
+         return &chipTraits[i];
+   return NULL;
+}
+
 //gets current chip type
 ChipType Burn::getChipType(void)
 {
@@ -629,6 +1423,146 @@ std::string Burn::getComPort(void)
    return comPort;
 }
 
+bool Burn::setRetries(int i)
+{
+   if(i < 0)
+      return false;
+
+   maxRetries = i;
+   return true;
+}
+
+int Burn::getRetries(void)
+{
+   return maxRetries;
+}
+
+bool Burn::setRetryDelay(int i)
+{
+   if(i < 0)
+      return false;
+
+   retryDelay = i;
+   return true;
+}
+
+int Burn::getRetryDelay(void)
+{
+   return retryDelay;
+}
+
+int Burn::getRetryCount(void)
+{
+   return retryCount;
+}
+
+int Burn::getBlocksRetried(void)
+{
+   return blocksRetried;
+}
+
+bool Burn::resetRetryStats(void)
+{
+   retryCount = blocksRetried = 0;
+   return true;
+}
+
+//sets the journal file used to pick up writes that died part way
+bool Burn::setJournalFile(std::string s)
+{
+   return journal.setFile(s);
+}
+
+//gets the journal file
+std::string Burn::getJournalFile(void)
+{
+   return journal.getFile();
+}
+
+bool Burn::setWriteCache(bool b)
+{
+   return cache.setEnabled(b);
+}
+
+bool Burn::getWriteCache(void)
+{
+   return cache.isEnabled();
+}
+
+bool Burn::getWriteSkipped(void)
+{
+   return writeSkipped;
+}
+
+bool Burn::setProgressObserver(ProgressObserver * o)
+{
+   return meter.setObserver(o);
+}
+
+ProgressObserver * Burn::getProgressObserver(void)
+{
+   return meter.getObserver();
+}
+
+const std::vector<PhaseTime> & Burn::getPhaseTimes(void)
+{
+   return meter.getPhases();
+}
+
+bool Burn::clearPhaseTimes(void)
+{
+   return meter.clearPhases();
+}
+
+long Burn::getBytesSent(void)
+{
+   return serial.getBytesSent();
+}
+
+long Burn::getBytesReceived(void)
+{
+   return serial.getBytesReceived();
+}
+
+bool Burn::runAsync(int op)
+{
+   switch(op)
+   {
+   case CHIP_ERASE:
+      return eraseChip() && verifyChipIsBlank();
+   case CHIP_BLANK:
+      return verifyChipIsBlank();
+   case CHIP_WRITE:
+      return writeFileToChip();
+   case CHIP_READ:
+      return readChipToFile();
+   case CHIP_VERIFY:
+      return verifyChipToFile();
+   default:
+      return false;
+   }
+}
+
+bool Burn::cancel(void)
+{
+   return meter.cancel();
+}
+
+bool Burn::setDeadline(long ms)
+{
+   return meter.setDeadline(ms);
+}
+
+bool Burn::clearDeadline(void)
+{
+   return meter.clearDeadline();
+}
+
+bool Burn::wasStopped(void)
+{
+   return meter.wasStopped();
+}
+
 //return block size for reads/writes to chip
 int Burn::getBlockSize(void)
 {
@@ -701,32 +1635,30 @@ bool Burn::sendCommands(void)
 //should be reset in any high-level write function and will increment itself
 bool Burn::sendDataBlock(void)
 {
-   int i, sz;
+   int sz = transferSize();
+
+   if(image == NULL || !sendDataBlock(image->at(offsetOnChip + binIdx)))
+      return false;
+
+   binIdx += sz;
+   return true;
+}
+
+bool Burn::sendDataBlock(const char * src)
+{
+   int sz;
    char tmp;
    char tmpDataBlock[maxHWBlockSize+1];
    bool isOK = true;
 
-   //if lastblocsize is set smaller than the
-   //normal blocksize, we need short read/write
-   if( lastBlockSize < blockSize)
-      sz = lastBlockSize;
-   else
-      sz = blockSize;
-
-   if( sz == 0)
-      sz = maxHWBlockSize;
+   sz = transferSize();
 
    //purge the receive buffers so we don't get a false return on
    //the dataOK check byte
    if(! serial.purgeRX() )
       return false;
 
-   for(i = 0; i < sz ; i++)
-   {
-      updateChecksum(bin[binIdx]);
-      tmpDataBlock[i] = bin[binIdx++];
-   }
-
+   copyWithChecksum(tmpDataBlock, src, sz);
    tmpDataBlock[sz] = getChecksum();
    if(! serial.sendBytes(tmpDataBlock, sz+1))
       return false;
@@ -740,13 +1672,12 @@ bool Burn::sendDataBlock(void)
    return false;
 }
 
-bool Burn::getDataBlock(void)
+//if lastblocsize is set smaller than the
+//normal blocksize, we need short read/write
+int Burn::transferSize(void)
 {
-   int i, sz;
-   char tmp[maxHWBlockSize+1];
+   int sz;
 
-   //if lastblocsize is set smaller than the
-   //normal blocksize, we need short read/write
    if(lastBlockSize < blockSize)
       sz = lastBlockSize;
    else
@@ -755,10 +1686,63 @@ bool Burn::getDataBlock(void)
    if(sz == 0)
       sz = maxHWBlockSize;
 
+   return sz;
+}
+
+//Makes sure bin has room for the number of bytes passed, if it doesn't a
+//bigger one comes from the pool with the old contents copied over, it
+//only ever grows so a Burn going through jobs settles on one buffer
+bool Burn::reserveBin(int size)
+{
+   char * tmp;
+
+   if(bin != NULL && binSize >= size)
+      return true;
+
+   if((tmp = BufferPool::acquire(size)) == NULL)
+      return false;
+
+   if(bin != NULL)
+      memcpy(tmp, bin, binSize);
+
+   BufferPool::release(bin);
+   bin = tmp;
+   binSize = size;
+   return true;
+}
+
+//reads the block straight into bin[] at binIdx, moving the index past it
+//the checksum lands in the byte after the block and is overwritten by the
+//next read, on a bad checksum the index is left where it was so the block
+//can be read again
+bool Burn::getDataBlock(void)
+{
+   int sz = transferSize();
+
+   if(bin == NULL || binIdx + sz + 1 > binSize)
+      return false;
+
+   binIdx += sz;
+   if(!getDataBlock(bin + binIdx - sz))
+   {
+      binIdx -= sz;
+      return false;
+   }
+   return true;
+}
+
+//The data and the checksum after it are read straight into dest
+//so it must have room for one byte past the block
+bool Burn::getDataBlock(char * dest)
+{
+   int sz;
+
+   sz = transferSize();
+
    //This will be sensitive to serial timeouts if not set properly
    //Or if it's run in blocking i/o mode since getbyte won't return
    //Timeouts probably need to be set to something like 100ms/500ms
-   if(!serial.getBytes( tmp, sz+1))
+   if(!serial.getBytes( dest, sz+1))
    {
       //std::cerr << "getBytes failed in getDataBlock size: "<< sz << std::endl;
       return false;
@@ -767,22 +1751,11 @@ bool Burn::getDataBlock(void)
    //This needs to walk the data bytes returned and
    //update the checksum, last byte returned should be the checksum
    //provided by the device
-   if( !resetChecksum())
+   if( !resetChecksum() || !updateChecksum(dest, sz))
       return false;
 
-   for(i=0; i<sz; i++)
-      updateChecksum(tmp[i]);
-
-   //If the data was recieved OK, copy the data into the array
-   //using the bin index, checksum will be last byte in tmp array
-   if(tmp[sz]==getChecksum())
-   {
-      for(i=0; i<sz && binIdx<maxBinSize; i++)
-      {
-         bin[binIdx++] = tmp[i];
-      }
+   if(dest[sz]==getChecksum())
       return true;
-   }
 
    //std::cerr << "Checksum verification on getDataBlock failed" << std::endl;
    return false;
@@ -791,9 +1764,28 @@ Burn::Burn( void )
 {
    foundDevice = false;
    romType = NONE;
+   romSize = NONE_SIZE;
+   traits = NULL;
+   addressIdx = 3;
+   bin = NULL;
+   binSize = 0;
    lastBlockSize = blockSize = maxHWBlockSize;
    checksumFirstByte = true;
-   offsetOnChip = 0;
+   offsetOnChip = transferEnd = 0;
+   currentBank = 0;
+   image = NULL;
+   differentialWrite = false;
+   pagesWritten = 0;
+   maxRetries = defaultRetries;
+   retryDelay = defaultRetryDelay;
+   retryCount = blocksRetried = 0;
+   writeSkipped = false;
    hardwareVersion = firmwareVersion = hardwareVersionCH = 0x00;
 
 }
+
+//the bin goes back to the pool for the next Burn
+Burn::~Burn( void )
+{
+   BufferPool::release(bin);
+}
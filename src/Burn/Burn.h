@@ -36,17 +36,17 @@
  *
  * the following improvements could be used in current implementation:
  *
- * 1) At this point the EECIV stuff isn't supported very well so that
- * part of the code can use some beefing up
- *
- * 2) most of the functions should be collapsed to use the bank functions
+ * 1) most of the functions should be collapsed to use the bank functions
  * if a whole chip is being written/erased  for a AM29 chip
  *
- * 3) Better support for banking where available, with offsets into banks being calc'd
- *
- * 4) Additional error checking in all read/write functions to make sure port is open
+ * 2) Additional error checking in all read/write functions to make sure port is open
  * and device has been found
  *
+ * EEC-IV bins are 1, 2 or 4 banks one after the other, each 56K or 64K,
+ * a 56K bank leaves out the bottom 8K the EEC doesn't see.  Bank n of the
+ * file goes at the top of 64K bank n of the chip and only those banks are
+ * erased, written and verified, the rest of the chip is left alone.
+ *
  * Otherwise, the implementation is pretty full, everything returns a bool
  * for future error checking or expansion, typedefs were attemtped to be used
  * in sane way to make things easier
@@ -60,7 +60,16 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <vector>
 #include "Serial.h"
+#include "Journal.h"
+#include "WriteCache.h"
+#include "Progress.h"
+#include "AsyncOp.h"
+#include "Image.h"
+
+//see BlockPipe.h, only clones need it
+class BlockPipe;
 
 //This matches 1st command byte for burn1
 //So it knows which type of chip to read/write to
@@ -84,7 +93,45 @@ enum ChipSize
    EECIV_SIZE = 0x80000
 };
 
-class Burn
+//What can be done to a chip, or'd together in ChipTraits
+enum ChipOp
+{
+   CHIP_READ = 0x01,
+   CHIP_WRITE = 0x02,
+   CHIP_ERASE = 0x04,
+   CHIP_VERIFY = 0x08,
+   CHIP_BLANK = 0x10
+};
+
+//Everything that differs between the chips the burner handles, there's an
+//entry per chip in the table in Burn.cpp, a new part is just a new entry
+struct ChipTraits
+{
+   ChipType type;
+   //name used on the command line and in manifests
+   const char * name;
+   const char * description;
+   ChipSize size;
+   //banks of size/banks bytes, 1 if the chip isn't banked
+   int banks;
+   //address bytes in a read/write command, 3 puts the bank in front
+   int addressBytes;
+   //bytes cleared by one erase command, 0 if it can't be erased
+   int eraseSize;
+   //bytes programmed as a page, 0 if it doesn't program by page
+   int pageSize;
+   //ChipOp's the chip supports
+   int ops;
+};
+
+//Range of chip addresses that failed a verify, end is one past the last bad byte
+struct MismatchRange
+{
+   int start;
+   int end;
+};
+
+class Burn : public AsyncTarget
 {
 
 
@@ -92,6 +139,12 @@ public:
    //Calcuates a running checksum, returning it each time
    bool updateChecksum(char);
 
+   //adds a whole block to the running checksum
+   bool updateChecksum(const char *, int);
+
+   //copies a block and adds it to the running checksum in the same pass
+   bool copyWithChecksum(char *, const char *, int);
+
    //resets checksum so that it starts fresh upon next call
    bool resetChecksum(void);
 
@@ -105,39 +158,99 @@ public:
    bool eraseChip(void);
 
    //Verify bin on chip is blank
+   //stops reading at the first block that isn't
    bool verifyChipIsBlank(void);
 
    //Verify bin on chip against the file specified by binFile
+   //stops reading at the first block that doesn't match
    bool verifyChipToFile(void);
 
+   //returns the address ranges that failed the last verify or blank check
+   //only the first failing block is looked at, so they all fall inside it
+   std::vector<MismatchRange> getMismatches(void);
+
    //Writes a bin to the selected chip from filename specified by binFile
    bool writeMemoryToChip(void);
 
+   //Reads the chip back and writes only the pages that differ from the bin
+   //in memory, only good for chips that program without an erase (AT29C256)
+   bool writeMemoryToChipDifferential(void);
+
+   //sets whether writeFileToChip uses the differential write on chips
+   //that can be programmed without an erase
+   bool setDifferentialWrite(bool);
+
+   //gets whether differential writes are enabled
+   bool getDifferentialWrite(void);
+
+   //returns number of pages written by the last differential write
+   int getPagesWritten(void);
+
    //reads a bin from the chip to the filename specified by binFile
    bool readChipToMemory(void);
 
    //function to write memory buffer to file
    bool writeMemoryToFile(void);
 
+   //streams the chip straight to the bin file, "-" for stdout, a block at
+   //a time without holding the whole thing, see StreamWriter.h
+   bool readChipToFile(void);
+
+   //same for just the current bank
+   bool readBankToFile(void);
+
+   //reads the whole chip into the pipe, each block is let out as soon
+   //as it's in for the other end to use while the next one is read
+   bool readChipToPipe(BlockPipe &);
+
+   //erases and blank checks the chip, if it's one that can be, then
+   //writes each block from the pipe as it comes in and verifies the
+   //lot against it at the end, gives up on the pipe if anything fails
+   bool writePipeToChip(BlockPipe &);
+
    //function to load the data from the memory buffer to disk
+   //Intel HEX and S-record files are loaded at the addresses they give
+   //and only the ranges they cover are written, raw bins go by their size
    bool readFileToMemory(void);
 
+   //returns the address ranges of the chip the bin has data for
+   std::vector<Extent> getExtents(void);
+
+   //uses the image passed as the bin instead of loading it from binFile,
+   //it isn't copied and has to stay around and unchanged until the
+   //write/verify is done, chip type needs to be set first
+   bool setImage(const Image *);
+
    //function to write file to chip and verify it
    //This does the erase, verify of erase, burn and verify in one shot
+   //the file is only loaded once, while the erase is running
    bool writeFileToChip(void);
 
    //Erase bank, only good for 29f040 chips, will return error if other chips selected
+   //returns once the erase is sent, the burner answers when it's done
    bool eraseBank(int);
 
+   //Same but waits for the burner to say the erase is done
+   bool eraseBankAndWait(int);
+
    //Verify bank is blank on 29f040 or eeciv
    bool verifyBankIsBlank(void);
 
-   //Write to a bank on 29f040 or eeciv
+   //loads binFile for the current bank, placed the way it would be on a
+   //chip the size of the bank, sets the offset
+   bool readFileToBank(void);
+
+   //Write the bin loaded by readFileToBank to a bank on 29f040 or eeciv
+   //the bank has to have been erased
    bool writeMemoryToBank(void);
 
-   //Verify bin on chip against the file specified by binFile
-   //Need to calculate offset into bank
-   bool verifyBankToFile(int);
+   //Verify the current bank against the file specified by binFile
+   bool verifyBankToFile(void);
+
+   //Writes binFile to the current bank and verifies it, unless the bank
+   //already holds it, the other banks are left alone, getWriteSkipped
+   //says if it was already there
+   bool writeFileToBank(void);
 
    //sent bank for 29F040 or eeciv adapter
    bool setBank(unsigned int);
@@ -152,6 +265,7 @@ public:
    int getOffset(void);
 
    //Calcuate offset of binary into bank, based upon file size
+   //the offset is from the start of the chip like calculateChipOffset
    bool calculateBankOffset(void);
 
    //sets the current chip type
@@ -160,6 +274,17 @@ public:
    //gets current chip type
    ChipType getChipType(void);
 
+   //loads the file into the image laid out for the chip type passed, the
+   //way readFileToMemory would, for images handed over with setImage
+   static bool loadImage(Image &, std::string, ChipType);
+
+   //returns the traits of the chip type or name passed, NULL if it's unknown
+   static const ChipTraits * getChipTraits(ChipType);
+   static const ChipTraits * getChipTraits(std::string);
+
+   //returns the traits of the nth known chip, NULL past the last one
+   static const ChipTraits * getChipTraitsAt(int);
+
    //sets the current chip type
    bool setBinFile(std::string);
 
@@ -172,6 +297,78 @@ public:
    //gets current com port
    std::string getComPort(void);
 
+   //sets how many more times a block is tried after it fails before
+   //the whole read/write gives up, only the failed block is sent again
+   bool setRetries(int);
+
+   //gets the number of retries per block
+   int getRetries(void);
+
+   //sets the wait in ms before the first retry of a block, it doubles
+   //for each retry after that
+   bool setRetryDelay(int);
+
+   //gets the wait before the first retry
+   int getRetryDelay(void);
+
+   //returns the number of retries done since the stats were last reset
+   int getRetryCount(void);
+
+   //returns the number of blocks that needed at least one retry
+   int getBlocksRetried(void);
+
+   //clears the retry stats
+   bool resetRetryStats(void);
+
+   //sets the journal file writes record their progress in, so a write that
+   //dies part way can be picked up from where it stopped, empty turns it off
+   bool setJournalFile(std::string);
+
+   //gets the journal file
+   std::string getJournalFile(void);
+
+   //with the cache on, writing the bin this Burn last wrote and verified
+   //to the chip is skipped if a spot check of the chip agrees, it's only
+   //kept as long as the Burn is since chips get swapped
+   bool setWriteCache(bool);
+   bool getWriteCache(void);
+
+   //true if the last writeFileToChip found the bin already on the chip
+   bool getWriteSkipped(void);
+
+   //the observer is told how writes, reads, verifies and blank checks
+   //are going after every block, NULL turns it off, it isn't deleted
+   bool setProgressObserver(ProgressObserver *);
+   ProgressObserver * getProgressObserver(void);
+
+   //how long each erase, blank check, write, verify and read took, in
+   //the order they ran, kept until cleared
+   const std::vector<PhaseTime> & getPhaseTimes(void);
+   bool clearPhaseTimes(void);
+
+   //bytes sent to and read back from the hardware since the port was opened
+   long getBytesSent(void);
+   long getBytesReceived(void);
+
+   //runs one of the CHIP_ ops for an AsyncOp, CHIP_ERASE erases and blank
+   //checks, CHIP_WRITE is writeFileToChip and CHIP_READ reads the chip to
+   //the bin file, see AsyncOp.h
+   bool runAsync(int);
+
+   //stops the erase, write, read, verify or blank check going on at the
+   //next block, from any thread, it stays stopped until setDeadline
+   bool cancel(void);
+
+   //gives up on transfers at the next block once the ms passed have gone
+   //by, 0 for no deadline, clears any earlier cancel
+   bool setDeadline(long);
+
+   //drops the deadline once an op is over, wasStopped still answers for it
+   bool clearDeadline(void);
+
+   //true if the last failure was down to a cancel or the deadline
+   bool wasStopped(void);
+
    //Sends commands to device
    bool sendCommands(void);
 
@@ -195,11 +392,18 @@ public:
    // starting at previously set binIndex
    bool getDataBlock(void);
 
+   //reads a block of data from the serial port into the buffer passed
+   //buffer needs room for the checksum after the block, doesn't touch bin[] or binIdx
+   bool getDataBlock(char *);
+
    //reads a block of data from the serial port
    // size will match blockSize and data will be in bin[]
    // starting at previously set binIndex
    bool sendDataBlock(void);
 
+   //sends a block of data from the buffer passed, doesn't touch bin[] or binIdx
+   bool sendDataBlock(const char *);
+
    //builds the command
    bool buildCommand(char, unsigned char *, int);
 
@@ -218,7 +422,102 @@ public:
    //Constructor
    Burn(void);
 
+   //Destructor
+   ~Burn(void);
+
 private:
+   //not copyable, the buffers from the pool would be handed back twice
+   Burn(const Burn &);
+   Burn & operator=(const Burn &);
+
+   //Erase the chip, if the bool is set the bin file is loaded
+   //into memory while waiting on the hardware to finish
+   bool eraseChip(bool);
+
+   //Writes the extents of the bin from the chip address passed to the
+   //end of the chip, the gaps between them are skipped
+   bool writeMemoryToChipFrom(unsigned int);
+
+   //returns the address a journaled write of the bin can carry on from
+   //after spot checking the last block, or the offset if there isn't one
+   int resumeAddress(void);
+
+   //returns the name for this device in the journal and write cache
+   std::string journalDevice(void);
+
+   //returns the name a bank of this device goes by in the write cache,
+   //-1 gives the start of the name that every bank's shares
+   std::string bankDevice(int);
+
+   //drops what the write cache has for the bank passed and the whole
+   //chip, -1 is the whole chip and drops every bank with it
+   void dropCached(int);
+
+   //bank the addresses from the 1st up to the 2nd are all in, -1 if
+   //they span more than one
+   int bankHolding(unsigned int, unsigned int);
+
+   //number of bytes in each bank, the whole chip for chips without banks
+   int bankSize(void);
+
+   //bank the address is in, always 0 on chips without banks
+   int bankOf(unsigned int);
+
+   //erases each bank the image has data in, leaving the others alone
+   bool eraseImageBanks(void);
+
+   //streams the chip from the 1st address up to the 2nd to binFile, see readChipToFile
+   bool readRangeToFile(unsigned int, unsigned int);
+
+   //true if the current bank already holds exactly what writing the
+   //bin loaded by readFileToBank would leave there
+   bool bankMatches(void);
+
+   //sends the erase for the bank passed, chips without banks ignore it
+   bool startErase(int);
+
+   //waits out what's left of an erase started at the time passed and
+   //checks the burner says it worked
+   bool eraseDone(long);
+
+   //reads a few blocks spread over the bin and compares them, used to
+   //make sure the chip still holds a cached bin
+   bool spotCheck(void);
+
+   //reads the block starting at the chip address passed into the buffer passed
+   bool readBlock(unsigned int, char *);
+
+   //called with the attempt number after a block fails, waits and clears
+   //the port, returns false once the block is out of retries
+   bool retryBlock(int);
+
+   //writes the number of bytes in the 3rd arg from the buffer passed
+   //to the chip address passed, must not be more than blockSize
+   bool writeBlock(unsigned int, const char *, int);
+
+   //Verify the chip is blank from the 1st address up to the 2nd
+   bool verifyRangeIsBlank(unsigned int, unsigned int);
+
+   //Verify the chip from the 1st address up to the 2nd against
+   //the bin loaded by readFileToMemory, only its extents are read
+   bool verifyRangeToMemory(unsigned int, unsigned int);
+
+   //Verify the chip from the 1st address up to the 2nd against the
+   //bytes passed, which start at the 1st, what matched is added to the
+   //count in the last arg for the meter
+   bool verifyBlocks(unsigned int, unsigned int, const char *, long &);
+
+   //makes sure bin can hold the number of bytes passed
+   bool reserveBin(int);
+
+   //number of bytes in the next block read/written, based upon lastBlockSize
+   int transferSize(void);
+
+   //records the runs of bytes in the block at the address passed that
+   //don't match the expected data, or 0xFF if no expected data is passed
+   void recordMismatches(unsigned int, const char *, const char *, int);
+
+
    //Largest bin we handle, this has an effect on bank
    //calculations used in reads/writes
    static const unsigned int maxBinSize = 524288;
@@ -232,6 +531,16 @@ private:
    //maximum possible size of block the hardware will accept
    static const unsigned int maxHWBlockSize = 256;
 
+   //how many blocks are written between updates to the journal
+   static const int journalInterval = 16;
+
+   //how many blocks a spot check of a cached bin reads
+   static const int cacheSamples = 8;
+
+   //retries per block and ms before the first one, unless set otherwise
+   static const int defaultRetries = 3;
+   static const int defaultRetryDelay = 10;
+
    //index for the 'R' or the 'W' command to be sent
    static const unsigned int readWriteIdx = 1;
 
@@ -247,8 +556,16 @@ private:
    //character that device sends to OK data reception
    static const int dataOK = 'O';
 
+   //time in ms we give the hardware to erase, docs say it takes 1/2 sec
+   static const int eraseDelay = 1000;
+
    ChipType romType;
    ChipSize romSize;
+   //traits of romType, NULL until it's set
+   const ChipTraits * traits;
+   //where the address starts in a read/write command, after the bank
+   //on chips that take one
+   int addressIdx;
    char hardwareVersion;
    char firmwareVersion;
    char hardwareVersionCH;
@@ -259,11 +576,33 @@ private:
    std::string binFile;
    std::string comPort;
    Serial serial;
-   int sizeOfBin;
+   Journal journal;
+   WriteCache cache;
+   bool writeSkipped;
+   ProgressMeter meter;
+   //first address the bin has data for
    int offsetOnChip;
+   //bank used by the bank functions, 0 until it's set
+   unsigned int currentBank;
+   //reads/writes are clamped so they don't run past this address
+   //normally the size of the chip
+   int transferEnd;
+   bool differentialWrite;
+   int pagesWritten;
+   int maxRetries;
+   int retryDelay;
+   int retryCount;
+   int blocksRetried;
    int blockSize;
    int lastBlockSize;
    int binIdx;
-   char bin[maxBinSize];
+   //sized to the chip when it's first needed, from BufferPool, with
+   //one extra byte so a block at the end of the chip has room for its checksum
+   char * bin;
+   int binSize;
+   //the bin being written/verified, fileImage unless setImage was used
+   const Image * image;
+   Image fileImage;
    int command[maxCommandLen];
+   std::vector<MismatchRange> mismatches;
 };
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Chip to chip copies, see BurnClone.h
+ */
+#include "BurnClone.h"
+#include "Timer.h"
+
+bool BurnClone::setPorts(std::string from, std::string to)
+{
+   if(from.empty() || to.empty() || from == to)
+      return false;
+
+   sourcePort = from;
+   targetPort = to;
+   return true;
+}
+
+std::string BurnClone::getSourcePort(void)
+{
+   return sourcePort;
+}
+
+std::string BurnClone::getTargetPort(void)
+{
+   return targetPort;
+}
+
+bool BurnClone::setChipType(ChipType ct)
+{
+   romType = ct;
+   return true;
+}
+
+ChipType BurnClone::getChipType(void)
+{
+   return romType;
+}
+
+bool BurnClone::setRetries(int i)
+{
+   if(i < 0)
+      return false;
+
+   retries = i;
+   return true;
+}
+
+bool BurnClone::setProgressObserver(ProgressObserver * o)
+{
+   observer = o;
+   return true;
+}
+
+//Both burners are found before anything starts, so a missing one
+//doesn't leave the other with an erased chip, the read goes on a thread
+//and the target works on this one, if the thread can't be started the
+//source is read in full first and the target still gets to copy it
+bool BurnClone::cloneChip(void)
+{
+   const ChipTraits * t = Burn::getChipTraits(romType);
+   Burn reader, target;
+   Thread thread;
+   bool ok = false;
+   long begin;
+
+   results.clear();
+   results.resize(2);
+   results[0].port = sourcePort;
+   results[1].port = targetPort;
+   elapsed = 0;
+   sourceOK = false;
+
+   if(t == NULL || !(t->ops & CHIP_READ) || !(t->ops & CHIP_WRITE))
+   {
+      results[0].failedAt = results[1].failedAt = "chip can't be copied";
+      return false;
+   }
+
+   //the thread gets at the source through this
+   source = &reader;
+
+   if(prepare(source, results[0]) && prepare(&target, results[1]) && pipe.open(t->size))
+   {
+      target.setProgressObserver(observer);
+      begin = Timer::currentMillis();
+
+      if(!thread.start(run, this))
+         sourceOK = source->readChipToPipe(pipe);
+
+      ok = target.writePipeToChip(pipe);
+
+      thread.join();
+      elapsed = Timer::currentMillis() - begin;
+
+      finish(source, results[0], sourceOK);
+      finish(&target, results[1], ok);
+   }
+   else
+   {
+      //only the one that couldn't be set up says why
+      for(unsigned int i = 0; i < results.size(); i++)
+         if(results[i].failedAt.empty())
+            results[i].failedAt = "not started";
+   }
+
+   pipe.close();
+   source = NULL;
+
+   return ok && sourceOK;
+}
+
+void * BurnClone::run(void * arg)
+{
+   BurnClone * c = (BurnClone *) arg;
+
+   c->sourceOK = c->source->readChipToPipe(c->pipe);
+   return NULL;
+}
+
+bool BurnClone::prepare(Burn * b, GangResult & r)
+{
+   r.ok = false;
+
+   if(!b->setComPort(r.port))
+      r.failedAt = "opening port";
+   else if(!b->checkForDevice())
+      r.failedAt = "finding device";
+   else if(!b->setChipType(romType))
+      r.failedAt = "setting chip type";
+   else
+   {
+      if(retries >= 0)
+         b->setRetries(retries);
+      return true;
+   }
+   return false;
+}
+
+void BurnClone::finish(Burn * b, GangResult & r, bool ok)
+{
+   const std::vector<PhaseTime> & phases = b->getPhaseTimes();
+
+   r.ok = ok;
+   if(!ok)
+      r.failedAt = phases.empty() ? "starting" : phases.back().phase;
+   r.millis = elapsed;
+   r.blocksRetried = b->getBlocksRetried();
+   r.retryCount = b->getRetryCount();
+   r.mismatches = b->getMismatches();
+}
+
+std::vector<GangResult> BurnClone::getResults(void)
+{
+   return results;
+}
+
+long BurnClone::getBytesCopied(void)
+{
+   const ChipTraits * t = Burn::getChipTraits(romType);
+
+   if(t == NULL || results.size() < 2 || !results[0].ok || !results[1].ok)
+      return 0;
+   return t->size;
+}
+
+long BurnClone::getElapsed(void)
+{
+   return elapsed;
+}
+
+BurnClone::BurnClone(void)
+{
+   source = NULL;
+   romType = NONE;
+   observer = NULL;
+   //leaves the Burn default alone
+   retries = -1;
+   sourceOK = false;
+   elapsed = 0;
+}
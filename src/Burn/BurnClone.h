@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Copying a chip from one Burn1/2 to a blank in another
+ *
+ * The source burner reads its chip on a thread of its own while the
+ * target erases and blank checks, then the target writes each block as
+ * soon as the source has it in and its checksum is good, so the read of
+ * one block goes on while the one before it is being written.  Once the
+ * last block is written the target is verified against what was read.
+ * The blocks are handed over in a BlockPipe the size of the chip, if
+ * either side fails the other one stops as well.
+ *
+ * Results are kept per burner the same way a gang write's are.
+ *
+ */
+#include <config.h>
+#include <string>
+#include <vector>
+#include "BurnGang.h"
+#include "BlockPipe.h"
+
+class BurnClone
+{
+
+public:
+   //sets the port of the burner with the chip to copy, then the one
+   //with the chip to write, they can't be the same
+   bool setPorts(std::string, std::string);
+
+   //gets the ports
+   std::string getSourcePort(void);
+   std::string getTargetPort(void);
+
+   //sets the chip type, has to be the same in both burners
+   bool setChipType(ChipType);
+
+   //gets the chip type
+   ChipType getChipType(void);
+
+   //passed on to both burners, see Burn
+   bool setRetries(int);
+
+   //told how the target is going, its erase, write and verify take the longest
+   bool setProgressObserver(ProgressObserver *);
+
+   //reads the source chip and writes it to the target at the same time,
+   //then verifies the target, true only if it matches
+   bool cloneChip(void);
+
+   //results of the last cloneChip, source first then target
+   std::vector<GangResult> getResults(void);
+
+   //bytes copied by the last cloneChip, 0 if it failed
+   long getBytesCopied(void);
+
+   //ms from both burners being found to the target being verified
+   long getElapsed(void);
+
+   //Constructor
+   BurnClone(void);
+
+private:
+   //thread entry, reads the source chip into the pipe
+   static void * run(void *);
+
+   //sets up the Burn for the port in the result, false and why in it if it can't
+   bool prepare(Burn *, GangResult &);
+
+   //copies the stats of the Burn into its result, failedAt is the phase
+   //it was in if it didn't work, both get the elapsed time
+   void finish(Burn *, GangResult &, bool);
+
+   std::string sourcePort;
+   std::string targetPort;
+   std::vector<GangResult> results;
+   BlockPipe pipe;
+   Burn * source;
+   ChipType romType;
+   ProgressObserver * observer;
+   int retries;
+   bool sourceOK;
+   long elapsed;
+};
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Gang programming, see BurnGang.h
+ */
+#include "BurnGang.h"
+#include "Timer.h"
+#include "Thread.h"
+
+bool BurnGang::setPorts(std::vector<std::string> p)
+{
+   if(p.empty())
+      return false;
+
+   ports = p;
+   return true;
+}
+
+std::vector<std::string> BurnGang::getPorts(void)
+{
+   return ports;
+}
+
+//the image is placed for the chip, so it's loaded again for a new one
+bool BurnGang::setChipType(ChipType ct)
+{
+   romType = ct;
+   image.clear();
+   return true;
+}
+
+ChipType BurnGang::getChipType(void)
+{
+   return romType;
+}
+
+//setting a new file drops the one already loaded
+bool BurnGang::setBinFile(std::string s)
+{
+   binFile = s;
+   image.clear();
+   return true;
+}
+
+std::string BurnGang::getBinFile(void)
+{
+   return binFile;
+}
+
+bool BurnGang::setDifferentialWrite(bool b)
+{
+   differentialWrite = b;
+   return true;
+}
+
+bool BurnGang::setRetries(int i)
+{
+   if(i < 0)
+      return false;
+
+   retries = i;
+   return true;
+}
+
+//The whole file is loaded in one go for the chip type, so it has to
+//be set first, raw, HEX and S-records all work
+bool BurnGang::readFileToMemory(void)
+{
+   image.clear();
+   return Burn::loadImage(image, binFile, romType);
+}
+
+//Starts a thread per port and waits on all of them, if a thread can't
+//be started that port is written on this one once the rest are going
+bool BurnGang::writeFileToChips(void)
+{
+   std::vector<Thread> threads(ports.size());
+   std::vector<Worker> workers(ports.size());
+   long begin;
+   unsigned int i;
+
+   results.clear();
+   elapsed = 0;
+
+   if(ports.empty() || (image.isEmpty() && !readFileToMemory()))
+      return false;
+
+   results.resize(ports.size());
+   begin = Timer::currentMillis();
+
+   for(i = 0; i < ports.size(); i++)
+   {
+      workers[i].gang = this;
+      workers[i].idx = i;
+      threads[i].start(run, &workers[i]);
+   }
+
+   for(i = 0; i < ports.size(); i++)
+      if(!threads[i].isStarted())
+         writeOne(i);
+
+   for(i = 0; i < ports.size(); i++)
+      threads[i].join();
+
+   elapsed = Timer::currentMillis() - begin;
+
+   return getChipsWritten() == (int) ports.size();
+}
+
+void * BurnGang::run(void * arg)
+{
+   Worker * w = (Worker *) arg;
+
+   w->gang->writeOne(w->idx);
+   return NULL;
+}
+
+//Only touches results[idx] so the threads stay out of each others way
+void BurnGang::writeOne(unsigned int idx)
+{
+   GangResult & r = results[idx];
+   Burn b;
+   long begin = Timer::currentMillis();
+
+   r.port = ports[idx];
+   r.ok = false;
+
+   if(!b.setComPort(r.port))
+      r.failedAt = "opening port";
+   else if(!b.setChipType(romType))
+      r.failedAt = "setting chip type";
+   else if(!b.setImage(&image))
+      r.failedAt = "bin doesn't fit chip";
+   else
+   {
+      b.setDifferentialWrite(differentialWrite);
+      if(retries >= 0)
+         b.setRetries(retries);
+      if(b.writeFileToChip())
+         r.ok = true;
+      else
+         r.failedAt = "writing";
+   }
+
+   r.millis = Timer::currentMillis() - begin;
+   r.blocksRetried = b.getBlocksRetried();
+   r.retryCount = b.getRetryCount();
+   r.mismatches = b.getMismatches();
+}
+
+std::vector<GangResult> BurnGang::getResults(void)
+{
+   return results;
+}
+
+int BurnGang::getChipsWritten(void)
+{
+   int n = 0;
+
+   for(unsigned int i = 0; i < results.size(); i++)
+      if(results[i].ok)
+         n++;
+   return n;
+}
+
+long BurnGang::getBytesWritten(void)
+{
+   return (long) image.getDataLength() * getChipsWritten();
+}
+
+long BurnGang::getElapsed(void)
+{
+   return elapsed;
+}
+
+BurnGang::BurnGang(void)
+{
+   romType = NONE;
+   differentialWrite = false;
+   //leaves the Burn default alone
+   retries = -1;
+   elapsed = 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Gang programming of one bin across several Burn1/2's at once
+ *
+ * The bin is read from disk once and handed to a Burn per port with
+ * Burn::setImage, so every burner writes and verifies from the same
+ * read only copy.  Each burner gets its own thread, they don't share
+ * anything else so there's no locking, results are kept per port and
+ * looked at once all of them are done.
+ *
+ * Journals aren't used here, every burner would be writing the same file.
+ *
+ * BurnClone.h keeps its results in a GangResult and brings this in, so
+ * like Thread.h it guards against being included twice.
+ *
+ */
+#ifndef BURNGANG_H
+#define BURNGANG_H
+#include <config.h>
+#include <string>
+#include <vector>
+#include "Burn.h"
+
+//How a write went on one of the burners
+struct GangResult
+{
+   std::string port;
+   bool ok;
+   //what it was doing when it failed, empty if it didn't
+   std::string failedAt;
+   long millis;
+   int blocksRetried;
+   int retryCount;
+   std::vector<MismatchRange> mismatches;
+};
+
+class BurnGang
+{
+
+public:
+   //sets the ports of the burners to write to, one thread per port
+   bool setPorts(std::vector<std::string>);
+
+   //gets the ports
+   std::vector<std::string> getPorts(void);
+
+   //sets the chip type, has to be the same in every burner
+   bool setChipType(ChipType);
+
+   //gets the chip type
+   ChipType getChipType(void);
+
+   //sets the bin file written to all the chips
+   bool setBinFile(std::string);
+
+   //gets the bin file
+   std::string getBinFile(void);
+
+   //passed on to each burner, see Burn
+   bool setDifferentialWrite(bool);
+   bool setRetries(int);
+
+   //reads the bin file into memory, done once for all the burners
+   //the chip type has to be set first so it can be placed
+   bool readFileToMemory(void);
+
+   //writes and verifies the bin on every burner at the same time, loading
+   //it first if that hasn't been done, true only if they all worked
+   bool writeFileToChips(void);
+
+   //per port results of the last writeFileToChips, in the order of the ports
+   std::vector<GangResult> getResults(void);
+
+   //number of chips written and verified by the last writeFileToChips
+   int getChipsWritten(void);
+
+   //bytes of bin written to the chips that worked
+   long getBytesWritten(void);
+
+   //ms from the first burner starting to the last one finishing
+   long getElapsed(void);
+
+   //Constructor
+   BurnGang(void);
+
+private:
+   //what each thread gets handed
+   struct Worker
+   {
+      BurnGang * gang;
+      unsigned int idx;
+   };
+
+   //thread entry, writes the bin on the burner for one port
+   static void * run(void *);
+
+   //does the work for the port at the index passed
+   void writeOne(unsigned int);
+
+   std::vector<std::string> ports;
+   std::vector<GangResult> results;
+   Image image;
+   std::string binFile;
+   ChipType romType;
+   bool differentialWrite;
+   int retries;
+   long elapsed;
+};
+#endif
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Operations on their own thread, see AsyncOp.h
+ */
+#include "AsyncOp.h"
+#include "Timer.h"
+#include <stddef.h>
+
+AsyncTarget::~AsyncTarget()
+{
+}
+
+bool AsyncOp::start(AsyncTarget * t, int o, long deadline, Callback cb, void * arg)
+{
+   if(t == NULL)
+      return false;
+
+   //a finished op's thread is cleaned up before the next one
+   if(running)
+   {
+      if(!isDone())
+         return false;
+      reap();
+   }
+
+   t->setDeadline(deadline);
+
+   lock.lock();
+   target = t;
+   op = o;
+   callback = cb;
+   callbackArg = arg;
+   done = result = false;
+   lock.unlock();
+
+   if(!thread.start(run, this))
+   {
+      lock.lock();
+      done = true;
+      lock.unlock();
+      return false;
+   }
+   return running = true;
+}
+
+bool AsyncOp::isDone(void)
+{
+   bool d;
+
+   lock.lock();
+   d = done;
+   lock.unlock();
+   return d;
+}
+
+bool AsyncOp::wait(void)
+{
+   lock.lock();
+   while(!done)
+      finished.wait(lock);
+   lock.unlock();
+
+   reap();
+   return result;
+}
+
+//Wakeups can come early, so the time left is worked out each time round
+bool AsyncOp::waitFor(long ms)
+{
+   long start = Timer::currentMillis();
+   long left = ms;
+   bool d;
+
+   lock.lock();
+   while(!done && left > 0)
+   {
+      finished.waitFor(lock, left);
+      left = ms - (Timer::currentMillis() - start);
+   }
+   d = done;
+   lock.unlock();
+
+   if(d)
+      reap();
+   return d;
+}
+
+bool AsyncOp::getResult(void)
+{
+   return isDone() && result;
+}
+
+//Done is checked holding the lock the op is marked done under, so a
+//cancel either lands before the op's deadline and cancel are cleared or
+//sees that it's done
+bool AsyncOp::cancel(void)
+{
+   bool ok = false;
+
+   lock.lock();
+   if(!done)
+      ok = target->cancel();
+   lock.unlock();
+   return ok;
+}
+
+//The callback goes first so whoever's waiting sees everything it did
+void * AsyncOp::run(void * p)
+{
+   AsyncOp * a = (AsyncOp *) p;
+   bool r = a->target->runAsync(a->op);
+
+   if(a->callback != NULL)
+      a->callback(r, a->callbackArg);
+
+   a->lock.lock();
+   //the deadline and any cancel were only for this op
+   a->target->clearDeadline();
+   a->result = r;
+   a->done = true;
+   a->finished.broadcast();
+   a->lock.unlock();
+   return NULL;
+}
+
+void AsyncOp::reap(void)
+{
+   if(running)
+   {
+      thread.join();
+      running = false;
+   }
+}
+
+AsyncOp::AsyncOp(void)
+{
+   target = NULL;
+   op = 0;
+   callback = NULL;
+   callbackArg = NULL;
+   running = false;
+   done = true;
+   result = false;
+}
+
+AsyncOp::~AsyncOp(void)
+{
+   if(running)
+      wait();
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Runs a long Burn or Ostrich operation on its own thread
+ *
+ * Start hands the target an op to run on a new thread and returns
+ * straight away, so a GUI or a script can get on with something else,
+ * like loading the next image, while the hardware is busy.  The op can
+ * be waited on, polled, given a deadline or cancelled.  Cancels and
+ * deadlines are noticed between blocks, a block already on the wire
+ * is finished first, so the op then fails the same way a bad block
+ * would and the target says it was stopped.
+ *
+ * Nothing else may be done with the target until the op is done, other
+ * than cancelling it.  The callback, like any progress observer, is
+ * called on the op's thread, before the op counts as done, so it mustn't
+ * wait on it.  An op still running when its AsyncOp goes away is waited
+ * for.
+ *
+ */
+#include <config.h>
+#include "Thread.h"
+
+//What Burn and Ostrich give an AsyncOp to work with
+class AsyncTarget
+{
+
+public:
+   //runs the op with the number passed, each target has its own list
+   virtual bool runAsync(int) = 0;
+
+   //stops the running op at the next block, safe from any thread
+   virtual bool cancel(void) = 0;
+
+   //gives up on ops at the next block once the ms passed have gone
+   //by, 0 for no deadline, clears any earlier cancel
+   virtual bool setDeadline(long) = 0;
+
+   //drops the deadline once the op is over, so it can't stop whatever is
+   //done with the target next, leaves wasStopped alone
+   virtual bool clearDeadline(void) = 0;
+
+   virtual ~AsyncTarget();
+};
+
+class AsyncOp
+{
+
+public:
+   //called once the op is done with how it went and the arg given to start
+   typedef void (*Callback)(bool, void *);
+
+   //starts the op numbered in the 2nd arg on the target with the deadline
+   //in the 3rd, 0 for none, the callback can be NULL, false if an op is
+   //already running here or the thread couldn't be started
+   bool start(AsyncTarget *, int, long, Callback, void *);
+
+   //true once the op has finished, or if none was started
+   bool isDone(void);
+
+   //waits for the op to finish and returns how it went
+   bool wait(void);
+
+   //waits up to the ms passed, true if the op finished in that time
+   bool waitFor(long);
+
+   //how the op went, false until it's done
+   bool getResult(void);
+
+   //asks the target to stop at the next block
+   bool cancel(void);
+
+   AsyncOp(void);
+   ~AsyncOp(void);
+
+private:
+   //there's a thread behind each one, they can't be copied
+   AsyncOp(const AsyncOp &);
+   AsyncOp & operator=(const AsyncOp &);
+
+   //thread entry, runs the op and signals anyone waiting
+   static void * run(void *);
+
+   //joins the thread once it's done
+   void reap(void);
+
+   AsyncTarget * target;
+   int op;
+   Callback callback;
+   void * callbackArg;
+   Thread thread;
+   Mutex lock;
+   Condition finished;
+   bool running;
+   bool done;
+   bool result;
+};
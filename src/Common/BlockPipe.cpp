@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Block hand off between threads, see BlockPipe.h
+ */
+#include "BlockPipe.h"
+#include "BufferPool.h"
+#include <stddef.h>
+
+bool BlockPipe::open(int len)
+{
+   close();
+   if(len <= 0 || (buf = BufferPool::acquire(len + 1)) == NULL)
+      return false;
+
+   lock.lock();
+   size = len;
+   filled = 0;
+   failed = false;
+   lock.unlock();
+   return true;
+}
+
+void BlockPipe::close(void)
+{
+   BufferPool::release(buf);
+   buf = NULL;
+   size = filled = 0;
+}
+
+char * BlockPipe::getBuffer(void)
+{
+   return buf;
+}
+
+int BlockPipe::getSize(void)
+{
+   return size;
+}
+
+//only ever moves forward
+bool BlockPipe::fill(int upTo)
+{
+   bool ok;
+
+   lock.lock();
+   if((ok = !failed && upTo <= size) && upTo > filled)
+      filled = upTo;
+   changed.broadcast();
+   lock.unlock();
+   return ok;
+}
+
+int BlockPipe::getFilled(void)
+{
+   int n;
+
+   lock.lock();
+   n = filled;
+   lock.unlock();
+   return n;
+}
+
+bool BlockPipe::waitFor(int upTo)
+{
+   bool ok;
+
+   lock.lock();
+   while(!failed && filled < upTo && upTo <= size)
+      changed.wait(lock);
+   ok = !failed && filled >= upTo;
+   lock.unlock();
+   return ok;
+}
+
+void BlockPipe::fail(void)
+{
+   lock.lock();
+   failed = true;
+   changed.broadcast();
+   lock.unlock();
+}
+
+bool BlockPipe::hasFailed(void)
+{
+   bool f;
+
+   lock.lock();
+   f = failed;
+   lock.unlock();
+   return f;
+}
+
+BlockPipe::BlockPipe(void)
+{
+   buf = NULL;
+   size = filled = 0;
+   failed = false;
+}
+
+BlockPipe::~BlockPipe(void)
+{
+   close();
+}
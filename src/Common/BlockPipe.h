@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Hands a chip's worth of blocks from one thread to another as they come in
+ *
+ * One side reads blocks into the buffer in address order and says how
+ * far it has got, the other waits on that and uses each block as soon
+ * as it's there, so the two overlap instead of one pass after the other.
+ * Either side can give up, which wakes the other one so it can stop too.
+ * The buffer comes from the BufferPool and has a byte spare past the
+ * end for the checksum of the last block read into it.
+ *
+ * Only one thread should be filling and one waiting.
+ *
+ */
+#include <config.h>
+#include "Thread.h"
+
+class BlockPipe
+{
+
+public:
+   //gets a buffer for the number of bytes passed, nothing is ready yet
+   bool open(int);
+
+   //gives the buffer back
+   void close(void);
+
+   char * getBuffer(void);
+   int getSize(void);
+
+   //the bytes from the start up to the number passed are ready
+   bool fill(int);
+
+   //number of bytes ready
+   int getFilled(void);
+
+   //waits until the bytes up to the number passed are ready, false if
+   //either side gave up first
+   bool waitFor(int);
+
+   //gives up, anyone waiting is woken
+   void fail(void);
+   bool hasFailed(void);
+
+   BlockPipe(void);
+   ~BlockPipe(void);
+
+private:
+   //the buffer is owned, it can't be copied
+   BlockPipe(const BlockPipe &);
+   BlockPipe & operator=(const BlockPipe &);
+
+   char * buf;
+   int size;
+   int filled;
+   bool failed;
+   Mutex lock;
+   Condition changed;
+};
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Pool of heap buffers, see BufferPool.h
+ */
+#include "BufferPool.h"
+#include <vector>
+#include <new>
+#include "Thread.h"
+
+//One buffer the pool has handed out at some point
+struct PoolEntry
+{
+   char * buf;
+   int size;
+   bool inUse;
+};
+
+//Only touched with the lock held, the vector is made on first use
+//so it doesn't depend on the order statics get set up in, the lock is
+//set up with the statics and nothing takes a buffer before main
+static Mutex poolLock;
+static std::vector<PoolEntry> * entries = NULL;
+
+//Takes the smallest free buffer that's big enough, otherwise makes a new one
+char * BufferPool::acquire(int size)
+{
+   PoolEntry e;
+   int best = -1;
+   char * buf = NULL;
+
+   if(size <= 0)
+      return NULL;
+
+   poolLock.lock();
+   if(entries == NULL)
+      entries = new std::vector<PoolEntry>;
+
+   for(unsigned int i = 0; i < entries->size(); i++)
+      if(!(*entries)[i].inUse && (*entries)[i].size >= size &&
+            (best < 0 || (*entries)[i].size < (*entries)[best].size))
+         best = i;
+
+   if(best >= 0)
+   {
+      (*entries)[best].inUse = true;
+      buf = (*entries)[best].buf;
+   }
+   else
+   {
+      e.size = (size + minSize - 1) / minSize * minSize;
+      e.buf = new (std::nothrow) char[e.size];
+      e.inUse = true;
+      if(e.buf != NULL)
+         entries->push_back(e);
+      buf = e.buf;
+   }
+   poolLock.unlock();
+
+   return buf;
+}
+
+void BufferPool::release(char * buf)
+{
+   if(buf == NULL)
+      return;
+
+   poolLock.lock();
+   for(unsigned int i = 0; entries != NULL && i < entries->size(); i++)
+      if((*entries)[i].buf == buf)
+         (*entries)[i].inUse = false;
+   poolLock.unlock();
+}
+
+void BufferPool::trim(void)
+{
+   std::vector<PoolEntry> kept;
+
+   poolLock.lock();
+   for(unsigned int i = 0; entries != NULL && i < entries->size(); i++)
+   {
+      if((*entries)[i].inUse)
+         kept.push_back((*entries)[i]);
+      else
+         delete [] (*entries)[i].buf;
+   }
+   if(entries != NULL)
+      entries->swap(kept);
+   poolLock.unlock();
+}
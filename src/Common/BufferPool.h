@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Pool of heap buffers shared by every Burn and Ostrich in the process
+ *
+ * Objects ask for a buffer the size of the chip or bank they're working
+ * with when they first need one and hand it back when they're done or
+ * need a bigger one.  Buffers that come back are kept and handed out
+ * again, so a process going through many jobs or holding many devices
+ * only allocates as much as it ever has in use at once.  Sizes are
+ * rounded up to a whole page, callers ask for a byte over the chip size
+ * for the checksum so a power of 2 would double every buffer.
+ * It's locked so objects on different threads can share it.
+ *
+ */
+#include <config.h>
+
+class BufferPool
+{
+
+public:
+   //returns a buffer of at least the size passed, NULL if it can't get one
+   static char * acquire(int);
+
+   //hands back a buffer from acquire so it can be used again, NULL is ignored
+   static void release(char *);
+
+   //frees every buffer that isn't in use
+   static void trim(void);
+
+private:
+   //buffers are handed out in multiples of this, a page on most systems
+   static const int minSize = 4096;
+};
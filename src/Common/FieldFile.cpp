@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Text files of fields a line at a time, see FieldFile.h
+ */
+#include "FieldFile.h"
+#include <sstream>
+#include <stdlib.h>
+
+bool FieldFile::open(std::string file)
+{
+   line = 0;
+   in.open(file.c_str());
+   return in.is_open();
+}
+
+bool FieldFile::next(std::vector<std::string> & fields)
+{
+   std::string text, f;
+
+   while(std::getline(in, text))
+   {
+      line++;
+      if(text.find('#') != std::string::npos)
+         text.erase(text.find('#'));
+
+      fields.clear();
+      std::istringstream split(text);
+      while(split >> f)
+         fields.push_back(f);
+      if(!fields.empty())
+         return true;
+   }
+   return false;
+}
+
+int FieldFile::getLine(void)
+{
+   return line;
+}
+
+//Decimal, or hex with a 0x in front, and not negative
+bool FieldFile::parseBank(std::string s, int & bank)
+{
+   char * end;
+
+   bank = strtol(s.c_str(), &end, 0);
+   return !s.empty() && *end == '\0' && bank >= 0;
+}
+
+FieldFile::FieldFile(void)
+{
+   line = 0;
+}
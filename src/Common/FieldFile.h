@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Text files of whitespace separated fields, a record per line
+ *
+ * Manifests and bank packs are both laid out this way: anything after a
+ * # is a comment, blank lines are skipped and the fields of each line
+ * are split on whitespace.  What the fields mean is left to the file
+ * reading them, this only hands them over a line at a time along with
+ * the line number for error messages.
+ *
+ */
+#include <config.h>
+#include <string>
+#include <vector>
+#include <fstream>
+
+class FieldFile
+{
+
+public:
+   //opens the file, false if it can't be
+   bool open(std::string);
+
+   //fills in the fields of the next line that has any, false at the end
+   bool next(std::vector<std::string> &);
+
+   //number of the line next returned its fields, from 1
+   int getLine(void);
+
+   //reads a bank number field, false if it isn't one
+   static bool parseBank(std::string, int &);
+
+   FieldFile(void);
+
+private:
+   std::ifstream in;
+   int line;
+};
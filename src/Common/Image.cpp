@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Image.h"
+#include "BufferPool.h"
+#include "Journal.h"
+#include <fstream>
+#include <cstring>
+#include <sys/stat.h>
+
+//Nanoseconds of the modification time where stat has them, a bin
+//rewritten within the same second still looks changed
+static long mtimeNanos(const struct stat & st)
+{
+#if defined(HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+   return (long) st.st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC_TV_NSEC)
+   return (long) st.st_mtimespec.tv_nsec;
+#else
+   return 0;
+#endif
+}
+
+static bool sameFile(const struct stat & a, const struct stat & b)
+{
+   return a.st_size == b.st_size && a.st_ino == b.st_ino &&
+          a.st_mtime == b.st_mtime && mtimeNanos(a) == mtimeNanos(b);
+}
+
+bool Image::load(std::string fileName, int size)
+{
+   return load(fileName, size, 0);
+}
+
+//Loaded as if the chip started at 0 then moved up to the base
+bool Image::load(std::string fileName, int size, int base)
+{
+   struct stat st, after;
+   std::ifstream file;
+   Extent whole;
+   int fsize;
+
+   if(isLoaded(fileName, size, base))
+      return true;
+   clear();
+
+   //the format comes from the same open the data is read through
+   file.open(fileName.c_str(), std::ios::in | std::ios::binary);
+   if(!file.is_open() || stat(fileName.c_str(), &st) != 0)
+      return false;
+   format = ImageLoader::detect(fileName, file);
+
+   //HEX and S-records are loaded over a buffer the size of the chip
+   //so the records can go where they say
+   if(format != RAW_BINARY)
+   {
+      buf = BufferPool::acquire(size + 1);
+      if(buf == NULL)
+         return false;
+      memset(buf, fill, size);
+      origin = 0;
+      if(!ImageLoader::load(file, format, buf, size, extents) || extents.empty())
+      {
+         clear();
+         return false;
+      }
+   }
+
+   //raw bins go at the top of the chip by their size
+   else
+   {
+      if(st.st_size <= 0 || st.st_size > size)
+         return false;
+      fsize = (int) st.st_size;
+
+      if((buf = BufferPool::acquire(fsize + 1)) == NULL || !file.read(buf, fsize))
+      {
+         clear();
+         return false;
+      }
+
+      origin = whole.start = size - fsize;
+      whole.end = size;
+      extents.push_back(whole);
+   }
+
+   origin += base;
+   for(unsigned int i = 0; i < extents.size(); i++)
+   {
+      extents[i].start += base;
+      extents[i].end += base;
+   }
+
+   //rewritten while it was being read, what's here could be half of each
+   if(stat(fileName.c_str(), &after) != 0 || !sameFile(st, after))
+   {
+      clear();
+      return false;
+   }
+
+   //remember what's loaded so it needn't be again
+   loadedName = fileName;
+   loadedSize = size;
+   loadedBase = base;
+   loadedFill = fill;
+   loadedTime = (long) st.st_mtime;
+   loadedNanos = mtimeNanos(st);
+   loadedInode = (unsigned long) st.st_ino;
+   loadedBytes = (long) st.st_size;
+   return true;
+}
+
+//Banks shorter than the chip's are missing their bottom, so the file is
+//spread out over a buffer from the start of the chip with the gaps filled
+bool Image::loadBanks(std::string fileName, int len, int bankSize)
+{
+   std::ifstream file;
+   struct stat st;
+   Extent bank;
+   int fsize;
+   int n;
+
+   clear();
+   file.open(fileName.c_str(), std::ios::in | std::ios::binary);
+   if(!file.is_open() || stat(fileName.c_str(), &st) != 0)
+      return false;
+   format = ImageLoader::detect(fileName, file);
+   fsize = (int) st.st_size;
+
+   if(format != RAW_BINARY || len <= 0 || len > bankSize || fsize <= 0 || fsize % len != 0)
+      return false;
+   n = fsize / len;
+
+   if((buf = BufferPool::acquire(n * bankSize + 1)) == NULL)
+      return false;
+   memset(buf, fill, n * bankSize);
+
+   for(int i = 0; i < n; i++)
+   {
+      bank.start = i * bankSize + bankSize - len;
+      bank.end = (i + 1) * bankSize;
+      if(!file.read(buf + bank.start, len))
+      {
+         clear();
+         return false;
+      }
+      extents.push_back(bank);
+   }
+   return true;
+}
+
+int Image::rawSize(std::string fileName)
+{
+   struct stat st;
+
+   if(stat(fileName.c_str(), &st) != 0 || ImageLoader::detect(fileName) != RAW_BINARY)
+      return 0;
+   return (int) st.st_size;
+}
+
+bool Image::isLoaded(std::string fileName, int size, int base) const
+{
+   struct stat st;
+
+   if(extents.empty() || fileName != loadedName || size != loadedSize ||
+         base != loadedBase || fill != loadedFill)
+      return false;
+   return stat(fileName.c_str(), &st) == 0 &&
+          (long) st.st_mtime == loadedTime &&
+          mtimeNanos(st) == loadedNanos &&
+          (unsigned long) st.st_ino == loadedInode &&
+          (long) st.st_size == loadedBytes;
+}
+
+int Image::place(std::string fileName, int size)
+{
+   struct stat st;
+
+   if(stat(fileName.c_str(), &st) != 0)
+      return -1;
+
+   //HEX and S-records are placed by their own addresses
+   if(ImageLoader::detect(fileName) != RAW_BINARY)
+      return 0;
+
+   if(st.st_size <= 0 || st.st_size > size)
+      return -1;
+   return size - (int) st.st_size;
+}
+
+void Image::clear(void)
+{
+   BufferPool::release(buf);
+   buf = NULL;
+   origin = 0;
+   format = RAW_BINARY;
+   extents.clear();
+   loadedName.clear();
+   loadedBase = 0;
+}
+
+ImageFormat Image::getFormat(void) const
+{
+   return format;
+}
+
+int Image::getPlace(void) const
+{
+   if(extents.empty())
+      return -1;
+   return format == RAW_BINARY ? origin - loadedBase : 0;
+}
+
+bool Image::isEmpty(void) const
+{
+   return extents.empty();
+}
+
+int Image::getStart(void) const
+{
+   return extents.empty() ? 0 : extents.front().start;
+}
+
+int Image::getEnd(void) const
+{
+   return extents.empty() ? 0 : extents.back().end;
+}
+
+int Image::getDataLength(void) const
+{
+   int len = 0;
+
+   for(unsigned int i = 0; i < extents.size(); i++)
+      len += extents[i].end - extents[i].start;
+   return len;
+}
+
+int Image::getDataLength(int start, int end) const
+{
+   int len = 0, from, to;
+
+   for(unsigned int i = 0; i < extents.size(); i++)
+   {
+      from = extents[i].start > start ? extents[i].start : start;
+      to = extents[i].end < end ? extents[i].end : end;
+      if(to > from)
+         len += to - from;
+   }
+   return len;
+}
+
+bool Image::setFill(char c)
+{
+   fill = c;
+   return true;
+}
+
+char Image::getFill(void) const
+{
+   return fill;
+}
+
+const std::vector<Extent> & Image::getExtents(void) const
+{
+   return extents;
+}
+
+//extents are sorted, so it's a binary search
+bool Image::covers(int addr) const
+{
+   int lo = 0, hi = (int) extents.size() - 1, mid;
+
+   while(lo <= hi)
+   {
+      mid = (lo + hi) / 2;
+      if(addr < extents[mid].start)
+         hi = mid - 1;
+      else if(addr >= extents[mid].end)
+         lo = mid + 1;
+      else
+         return true;
+   }
+   return false;
+}
+
+const char * Image::at(int addr) const
+{
+   return buf + addr - origin;
+}
+
+//same hash a dense bin at the start address would have had, so
+//journals written before images keep working for raw bins
+std::string Image::hash(void) const
+{
+   if(extents.empty())
+      return "";
+   return Journal::hash(at(getStart()), getEnd() - getStart(), getStart());
+}
+
+//Works out how far into the data the sample starts then walks the
+//extents to find the address that lands on, samples stop at the end
+//of the extent they start in
+bool Image::sample(int i, int n, int len, Extent & r) const
+{
+   long long pos;
+
+   if(extents.empty() || n <= 0 || i < 0 || i >= n || len <= 0)
+      return false;
+
+   pos = (long long) getDataLength() * i / n;
+   for(unsigned int e = 0; e < extents.size(); e++)
+   {
+      if(pos < extents[e].end - extents[e].start)
+      {
+         r.start = extents[e].start + (int) pos;
+         r.end = r.start + len < extents[e].end ? r.start + len : extents[e].end;
+         return true;
+      }
+      pos -= extents[e].end - extents[e].start;
+   }
+   return false;
+}
+
+Image::Image()
+{
+   buf = NULL;
+   origin = 0;
+   format = RAW_BINARY;
+   fill = (char) 0xFF;
+   loadedSize = 0;
+   loadedBase = 0;
+   loadedFill = fill;
+   loadedTime = 0;
+   loadedNanos = 0;
+   loadedInode = 0;
+   loadedBytes = 0;
+}
+
+Image::~Image()
+{
+   clear();
+}
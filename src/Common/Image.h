@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * A bin as it lays on a chip or bank
+ *
+ * Instead of a dense buffer the size of the chip plus an offset, an
+ * image keeps the ranges of the chip its file actually has bytes for
+ * and the fill that's assumed everywhere else.  A raw bin is a single
+ * range ending at the top of the chip, HEX and S-records have one per
+ * run of records.  Writes and verifies walk the ranges so the gaps in
+ * a sparse file never go over the wire.
+ *
+ * Files are read into a pooled buffer, a copy that can't change or go
+ * away under a burn however the file is rewritten in the meantime.
+ * Loading the same file again, unchanged and for the same size, keeps
+ * what's there, so batches of verifies of one bin only read it once.
+ * Unchanged goes by the size, inode and modification time down to the
+ * nanosecond where the system keeps it, and a file that changes while
+ * it's being read is refused.  Images can't be copied but can be shared
+ * by pointer between objects working on the same file.
+ *
+ */
+#include <config.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "ImageLoader.h"
+
+class Image
+{
+
+public:
+   //loads the raw, HEX or S-record file for a chip or bank of the size
+   //in the 2nd arg, fails if any of it lands outside of it
+   bool load(std::string, int);
+
+   //same, but the chip or bank starts at the address in the 3rd arg, for
+   //a bin that goes in one bank of a bigger chip
+   bool load(std::string, int, int);
+
+   //loads a raw bin made of banks of the length in the 2nd arg one after
+   //the other, each goes at the top of the bank of the chip with the same
+   //number, the chip's banks being the size in the 3rd arg
+   bool loadBanks(std::string, int, int);
+
+   //size of the file if it's a raw bin, 0 if it isn't or can't be read
+   static int rawSize(std::string);
+
+   //where the file starts on a chip or bank of the size in the 2nd arg,
+   //0 for HEX and S-records, -1 if it can't be read or doesn't fit
+   //only looks at the file's size, nothing is loaded
+   static int place(std::string, int);
+
+   //true if the last load was of this file, with this size, base and
+   //fill, and the file hasn't changed since, only stats the file
+   bool isLoaded(std::string, int, int) const;
+
+   //format of the file the last load or loadBanks found, raw if there
+   //wasn't one, loadBanks leaves it set when it turns down a HEX file
+   ImageFormat getFormat(void) const;
+
+   //where the loaded file starts the way place would have it, without
+   //opening the file again, -1 if nothing's loaded
+   int getPlace(void) const;
+
+   //drops the bytes, the image is empty again
+   void clear(void);
+   bool isEmpty(void) const;
+
+   //first address with data and one past the last
+   int getStart(void) const;
+   int getEnd(void) const;
+
+   //number of bytes the extents hold between them
+   int getDataLength(void) const;
+
+   //number of those bytes from the 1st address up to the 2nd
+   int getDataLength(int, int) const;
+
+   //value the gaps are taken to hold, set before loading
+   bool setFill(char);
+   char getFill(void) const;
+
+   const std::vector<Extent> & getExtents(void) const;
+
+   //true if the address passed falls inside one of the extents
+   bool covers(int) const;
+
+   //bytes for the chip address passed, from there to the end of its
+   //extent are valid, gaps read as the fill
+   const char * at(int) const;
+
+   //journal hash of everything from start to end with where it goes
+   std::string hash(void) const;
+
+   //range of up to the number of bytes in the 3rd arg for the 1st of the
+   //number of samples in the 2nd, spread evenly over the data, for spot checks
+   bool sample(int, int, int, Extent &) const;
+
+   Image();
+   ~Image();
+
+private:
+   //copying would hand back the same pooled buffer twice
+   Image(const Image &);
+   Image & operator=(const Image &);
+
+   char * buf;
+   int origin;
+   ImageFormat format;
+   char fill;
+   std::vector<Extent> extents;
+
+   //what was loaded, to tell if a load can be skipped
+   std::string loadedName;
+   int loadedSize;
+   int loadedBase;
+   char loadedFill;
+   long loadedTime;
+   long loadedNanos;
+   unsigned long loadedInode;
+   long loadedBytes;
+};
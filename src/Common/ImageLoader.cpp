@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Intel HEX and S-record loaders, see ImageLoader.h
+ */
+#include "ImageLoader.h"
+#include <fstream>
+#include <algorithm>
+#include <ctype.h>
+
+//A raw bin can start with a : or an S and a digit as easily as anything
+//else, so the first line has to be a whole good record, or the extension
+//has to say what it is
+ImageFormat ImageLoader::detect(std::string fileName)
+{
+   std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+
+   return detect(fileName, in);
+}
+
+ImageFormat ImageLoader::detect(std::string fileName, std::istream & in)
+{
+   std::vector<unsigned char> b;
+   std::string line, ext;
+   std::string::size_type dot;
+   char c;
+
+   dot = fileName.find_last_of("./");
+   if(dot != std::string::npos && fileName[dot] == '.')
+      for(unsigned int i = dot + 1; i < fileName.size(); i++)
+         ext += tolower((unsigned char) fileName[i]);
+
+   if(ext == "hex" || ext == "ihx" || ext == "ihex")
+      return INTEL_HEX;
+   if(ext == "s19" || ext == "s28" || ext == "s37" || ext == "srec" || ext == "mot")
+      return MOTOROLA_SREC;
+
+   //no record is longer than this, a raw bin may have no newline at all
+   while((int) line.size() < maxLineLength && in.get(c) && c != '\n')
+      line += c;
+   while(!line.empty() && isspace((unsigned char) line[line.size()-1]))
+      line.erase(line.size()-1);
+
+   //back to the start for whoever loads it
+   in.clear();
+   in.seekg(0);
+
+   if(record(line, INTEL_HEX, b))
+      return INTEL_HEX;
+   if(record(line, MOTOROLA_SREC, b))
+      return MOTOROLA_SREC;
+   return RAW_BINARY;
+}
+
+//Lines are handled as they're read so the file is never held in memory
+bool ImageLoader::load(std::string fileName, char * buf, int len, std::vector<Extent> & extents)
+{
+   std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+
+   extents.clear();
+   if(!in.is_open())
+      return false;
+   return load(in, detect(fileName, in), buf, len, extents);
+}
+
+bool ImageLoader::load(std::istream & in, ImageFormat format, char * buf, int len, std::vector<Extent> & extents)
+{
+   std::string line;
+   bool end = false;
+   bool ok = true;
+   int base = 0;
+
+   extents.clear();
+
+   if(format == RAW_BINARY)
+      return false;
+
+   while(ok && !end && std::getline(in, line))
+   {
+      //DOS line endings and trailing blanks
+      while(!line.empty() && isspace((unsigned char) line[line.size()-1]))
+         line.erase(line.size()-1);
+      if(line.empty())
+         continue;
+
+      if(format == INTEL_HEX)
+         ok = intelHexLine(line, buf, len, extents, base, end);
+      else
+         ok = srecLine(line, buf, len, extents, end);
+   }
+
+   if(!ok)
+   {
+      extents.clear();
+      return false;
+   }
+
+   mergeExtents(extents);
+   return true;
+}
+
+bool ImageLoader::decode(const std::string & s, std::vector<unsigned char> & bytes)
+{
+   int hi, lo;
+
+   bytes.clear();
+   if(s.size() % 2)
+      return false;
+
+   for(unsigned int i = 0; i < s.size(); i += 2)
+   {
+      if(!isxdigit((unsigned char) s[i]) || !isxdigit((unsigned char) s[i+1]))
+         return false;
+      hi = isdigit((unsigned char) s[i]) ? s[i] - '0' : toupper(s[i]) - 'A' + 10;
+      lo = isdigit((unsigned char) s[i+1]) ? s[i+1] - '0' : toupper(s[i+1]) - 'A' + 10;
+      bytes.push_back((hi << 4) | lo);
+   }
+   return true;
+}
+
+//Decodes the record after its marker, checking the length and checksum
+bool ImageLoader::record(const std::string & line, ImageFormat format, std::vector<unsigned char> & b)
+{
+   unsigned char sum = 0;
+
+   if(format == INTEL_HEX)
+   {
+      if(line.empty() || line[0] != ':' || !decode(line.substr(1), b) || b.size() < 5)
+         return false;
+      if((int) b.size() != b[0] + 5)
+         return false;
+   }
+   else if(format == MOTOROLA_SREC)
+   {
+      if(line.size() < 4 || line[0] != 'S' || !isdigit((unsigned char) line[1]) ||
+            !decode(line.substr(2), b) || b.empty())
+         return false;
+      if((int) b.size() != b[0] + 1)
+         return false;
+   }
+   else
+      return false;
+
+   for(unsigned int i = 0; i < b.size(); i++)
+      sum += b[i];
+
+   return format == INTEL_HEX ? sum == 0 : sum == 0xFF;
+}
+
+void ImageLoader::addExtent(std::vector<Extent> & extents, int start, int end)
+{
+   Extent e;
+
+   if(!extents.empty() && extents.back().end == start)
+   {
+      extents.back().end = end;
+      return;
+   }
+   e.start = start;
+   e.end = end;
+   extents.push_back(e);
+}
+
+static bool extentBefore(const Extent & a, const Extent & b)
+{
+   return a.start < b.start;
+}
+
+void ImageLoader::mergeExtents(std::vector<Extent> & extents)
+{
+   std::vector<Extent> merged;
+
+   std::sort(extents.begin(), extents.end(), extentBefore);
+   for(unsigned int i = 0; i < extents.size(); i++)
+   {
+      if(!merged.empty() && extents[i].start <= merged.back().end)
+      {
+         if(extents[i].end > merged.back().end)
+            merged.back().end = extents[i].end;
+      }
+      else
+         merged.push_back(extents[i]);
+   }
+   extents.swap(merged);
+}
+
+//:LLAAAATT<data>CC, the bytes after the colon sum to 0
+//base carries the upper address from type 02 and 04 records
+bool ImageLoader::intelHexLine(const std::string & line, char * buf, int len,
+                               std::vector<Extent> & extents, int & base, bool & end)
+{
+   std::vector<unsigned char> b;
+   int count, addr;
+
+   if(!record(line, INTEL_HEX, b))
+      return false;
+
+   count = b[0];
+
+   addr = base + ((b[1] << 8) | b[2]);
+   switch(b[3])
+   {
+   //data
+   case 0x00:
+      if(addr < 0 || addr + count > len)
+         return false;
+      for(int i = 0; i < count; i++)
+         buf[addr + i] = b[4 + i];
+      if(count)
+         addExtent(extents, addr, addr + count);
+      break;
+
+   //end of file
+   case 0x01:
+      end = true;
+      break;
+
+   //extended segment address, paragraph in the data
+   case 0x02:
+      if(count != 2)
+         return false;
+      base = ((b[4] << 8) | b[5]) << 4;
+      break;
+
+   //extended linear address, upper 16 bits in the data
+   case 0x04:
+      if(count != 2)
+         return false;
+      base = ((b[4] << 8) | b[5]) << 16;
+      break;
+
+   //start addresses mean nothing to a rom
+   case 0x03:
+   case 0x05:
+      break;
+
+   default:
+      return false;
+   }
+   return true;
+}
+
+//STLL<address><data>CC, the bytes from the length on sum to 0xFF
+//S1/S2/S3 carry data with 2/3/4 address bytes, the rest are skipped
+bool ImageLoader::srecLine(const std::string & line, char * buf, int len,
+                           std::vector<Extent> & extents, bool & end)
+{
+   std::vector<unsigned char> b;
+   int addrBytes, addr, count;
+   char type;
+
+   if(!record(line, MOTOROLA_SREC, b))
+      return false;
+
+   type = line[1];
+   switch(type)
+   {
+   case '1':
+   case '2':
+   case '3':
+      addrBytes = type - '0' + 1;
+      break;
+
+   //end records
+   case '7':
+   case '8':
+   case '9':
+      end = true;
+      return true;
+
+   //header and record counts
+   case '0':
+   case '5':
+   case '6':
+      return true;
+
+   default:
+      return false;
+   }
+
+   count = b[0] - addrBytes - 1;
+   if(count < 0)
+      return false;
+
+   addr = 0;
+   for(int i = 0; i < addrBytes; i++)
+      addr = (addr << 8) | b[1 + i];
+
+   if(addr < 0 || addr + count > len)
+      return false;
+   for(int i = 0; i < count; i++)
+      buf[addr + i] = b[1 + addrBytes + i];
+   if(count)
+      addExtent(extents, addr, addr + count);
+
+   return true;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Loaders for bins kept as Intel HEX or Motorola S-records
+ *
+ * The file is read a line at a time and each data record is decoded
+ * straight into the buffer at the address it gives, nothing else in
+ * the buffer is touched.  The address ranges the records covered are
+ * handed back as extents, sorted and with touching ranges merged, so
+ * callers know which parts of the buffer came from the file and which
+ * are just whatever fill they put there first.
+ *
+ * Raw binaries aren't handled here, they carry no addresses and are
+ * placed by their size the way they always have been.
+ *
+ */
+#include <config.h>
+#include <string>
+#include <vector>
+#include <istream>
+
+//Range of addresses, end is one past the last byte
+struct Extent
+{
+   int start;
+   int end;
+};
+
+enum ImageFormat
+{
+   RAW_BINARY,
+   INTEL_HEX,
+   MOTOROLA_SREC
+};
+
+class ImageLoader
+{
+
+public:
+   //works out the format of the file, .hex/.ihx or .s19/.s28/.s37/.srec/.mot
+   //say so outright, otherwise the first line has to be a good Intel HEX
+   //or S-record record, anything else is raw
+   static ImageFormat detect(std::string);
+
+   //same for the file named in the 1st arg already open in the 2nd, which
+   //is left back at the start so it can be loaded from
+   static ImageFormat detect(std::string, std::istream &);
+
+   //loads the HEX or S-record file into the buffer, which holds the number
+   //of bytes in the 3rd arg, the extents the records covered go in the 4th
+   //fails on a bad record or checksum, or data outside of the buffer
+   static bool load(std::string, char *, int, std::vector<Extent> &);
+
+   //same from a file that's already open and detected as the format passed
+   static bool load(std::istream &, ImageFormat, char *, int, std::vector<Extent> &);
+
+private:
+   //longest line worth reading when looking for a first record, a full
+   //255 byte HEX record is 521 characters
+   static const int maxLineLength = 600;
+
+   //decodes the record in the 1st arg as the format passed into bytes,
+   //false unless its digits, length and checksum are all good
+   static bool record(const std::string &, ImageFormat, std::vector<unsigned char> &);
+
+   //decodes the hex digits in the 1st arg into bytes, false if one isn't hex
+   static bool decode(const std::string &, std::vector<unsigned char> &);
+
+   //adds the range to the extents, growing the last one if it follows on
+   static void addExtent(std::vector<Extent> &, int, int);
+
+   //sorts the extents and merges any that touch or overlap
+   static void mergeExtents(std::vector<Extent> &);
+
+   //one line of each format, false if it's bad, the 2nd bool is set at the end record
+   static bool intelHexLine(const std::string &, char *, int, std::vector<Extent> &, int &, bool &);
+   static bool srecLine(const std::string &, char *, int, std::vector<Extent> &, bool &);
+};
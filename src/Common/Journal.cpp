@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * On disk journal of how far a write got, see Journal.h
+ */
+#include "Journal.h"
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+
+bool Journal::setFile(std::string s)
+{
+   journalFile = s;
+   return true;
+}
+
+std::string Journal::getFile(void)
+{
+   return journalFile;
+}
+
+bool Journal::isEnabled(void)
+{
+   return !journalFile.empty();
+}
+
+int Journal::getResumeAddress(std::string device, std::string h)
+{
+   if(!isEnabled() || !load())
+      return -1;
+
+   for(unsigned int i = 0; i < entries.size(); i++)
+      if(entries[i].device == device)
+         return entries[i].hash == h ? entries[i].address : -1;
+
+   return -1;
+}
+
+bool Journal::record(std::string device, std::string h, int address)
+{
+   Entry e;
+   unsigned int i;
+
+   int held;
+   bool ok;
+
+   if(!isEnabled())
+      return false;
+
+   held = lockFile(journalFile);
+
+   //A missing journal is fine, it just hasn't been written yet
+   load();
+
+   for(i = 0; i < entries.size(); i++)
+      if(entries[i].device == device)
+         break;
+
+   if(i == entries.size())
+   {
+      e.device = device;
+      entries.push_back(e);
+   }
+   entries[i].hash = h;
+   entries[i].address = address;
+
+   ok = save();
+   unlockFile(held);
+   return ok;
+}
+
+bool Journal::clear(std::string device)
+{
+   int held;
+   bool ok = true;
+
+   if(!isEnabled())
+      return false;
+
+   held = lockFile(journalFile);
+   if(load())
+   {
+      for(unsigned int i = 0; i < entries.size(); i++)
+         if(entries[i].device == device)
+         {
+            entries.erase(entries.begin() + i);
+            ok = save();
+            break;
+         }
+   }
+   unlockFile(held);
+   return ok;
+}
+
+//64 bit FNV-1a, plenty to tell one bin from another
+std::string Journal::hash(const char * buf, int len, int offset)
+{
+   unsigned long long h = 14695981039346656037ULL;
+   char out[17];
+   int i;
+
+   for(i = 0; i < 4; i++)
+   {
+      h ^= (unsigned char) (offset >> (i * 8));
+      h *= 1099511628211ULL;
+   }
+   for(i = 0; i < len; i++)
+   {
+      h ^= (unsigned char) buf[i];
+      h *= 1099511628211ULL;
+   }
+
+   snprintf(out, sizeof(out), "%016llx", h);
+   return std::string(out);
+}
+
+bool Journal::load(void)
+{
+   std::ifstream in;
+   std::string line;
+   Entry e;
+
+   entries.clear();
+   in.open(journalFile.c_str());
+   if(!in.is_open())
+      return false;
+
+   while(std::getline(in, line))
+   {
+      std::istringstream fields(line);
+      if(fields >> e.device >> e.hash >> e.address)
+         entries.push_back(e);
+   }
+   return true;
+}
+
+bool Journal::save(void)
+{
+   std::ofstream out;
+   std::string tmp = journalFile + ".tmp";
+
+   out.open(tmp.c_str(), std::ios::out | std::ios::trunc);
+   if(!out.is_open())
+      return false;
+
+   for(unsigned int i = 0; i < entries.size(); i++)
+      out << entries[i].device << " " << entries[i].hash << " " << entries[i].address << std::endl;
+
+   out.close();
+   if(out.fail())
+      return false;
+
+   return rename(tmp.c_str(), journalFile.c_str()) == 0;
+}
+
+//The file itself is replaced by each save, so the lock is kept on a
+//file of its own next to it that stays put
+int Journal::lockFile(std::string file)
+{
+#ifdef WIN32
+   return -1;
+#else
+   std::string name = file + ".lock";
+   int fd = open(name.c_str(), O_RDWR | O_CREAT, 0666);
+
+   if(fd >= 0 && flock(fd, LOCK_EX) != 0)
+   {
+      close(fd);
+      fd = -1;
+   }
+   return fd;
+#endif
+}
+
+void Journal::unlockFile(int fd)
+{
+#ifndef WIN32
+   if(fd >= 0)
+   {
+      flock(fd, LOCK_UN);
+      close(fd);
+   }
+#endif
+}
+
+Journal::Journal(void)
+{
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * On disk journal of how far a write got
+ *
+ * Each line of the journal file is a device, the hash of the bin
+ * being written to it, and the address up to which the device has
+ * acknowledged the data.  If a write dies part way the next write of
+ * the same bin to the same device can look itself up here, spot check
+ * the last block and carry on from there instead of starting over.
+ * Entries are removed once the write has been verified.
+ *
+ * Acknowledged isn't verified, only the last block is read back before
+ * carrying on, so a block the device took badly earlier on is caught by
+ * the verify at the end of the write rather than at the resume.  Each
+ * change to the file is made holding a lock on a .lock file next to it,
+ * so burners in one process or several sharing a journal don't lose
+ * each other's entries, windows builds go without the lock.
+ *
+ */
+#include <config.h>
+#include <string>
+#include <vector>
+
+class Journal
+{
+
+public:
+   //sets the file the journal is kept in, empty turns journaling off
+   bool setFile(std::string);
+
+   //gets the file the journal is kept in
+   std::string getFile(void);
+
+   //returns true if a journal file has been set
+   bool isEnabled(void);
+
+   //returns the address a write of the bin with the hash in the 2nd arg to
+   //the device in the 1st can carry on from, or -1 if there isn't one
+   int getResumeAddress(std::string, std::string);
+
+   //records that the device has taken the bin up to the address passed
+   bool record(std::string, std::string, int);
+
+   //removes the entry for the device, done once a write is verified
+   bool clear(std::string);
+
+   //returns a hex string hash of the bin, the offset it goes at is
+   //included so the same data at a different place doesn't match
+   static std::string hash(const char *, int, int);
+
+   //takes and drops a lock between processes on the file passed, held
+   //around a load and save, lockFile returns what unlockFile needs, -1 if
+   //there's no lock to be had, WriteCache uses these too
+   static int lockFile(std::string);
+   static void unlockFile(int);
+
+   //Constructor
+   Journal(void);
+
+private:
+   struct Entry
+   {
+      std::string device;
+      std::string hash;
+      int address;
+   };
+
+   //reads the journal file into entries
+   bool load(void);
+
+   //writes entries out to the journal file, through a temp file and a rename
+   //so a crash part way doesn't lose the whole journal
+   bool save(void);
+
+
+   std::string journalFile;
+   std::vector<Entry> entries;
+};
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Buffer compare and checksum kernels, see Kernels.h
+ *
+ * On x86 with gcc/clang the SSE2 and AVX2 versions are compiled with
+ * target attributes so the rest of the build doesn't need -mavx2, and
+ * which one is used is decided by the CPU the first time a kernel runs.
+ */
+#include "Kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+typedef int (*firstNonBlankFunc)(const char *, int);
+typedef int (*firstDifferenceFunc)(const char *, const char *, int);
+typedef char (*checksumFunc)(const char *, int);
+typedef char (*copyChecksumFunc)(char *, const char *, int);
+
+static int firstNonBlankScalar(const char * buf, int len)
+{
+   int i;
+
+   for(i = 0; i < len; i++)
+      if(buf[i] != (char) 0xFF)
+         return i;
+
+   return len;
+}
+
+static int firstDifferenceScalar(const char * a, const char * b, int len)
+{
+   int i;
+
+   for(i = 0; i < len; i++)
+      if(a[i] != b[i])
+         return i;
+
+   return len;
+}
+
+static char checksumScalar(const char * buf, int len)
+{
+   unsigned char sum = 0;
+   int i;
+
+   for(i = 0; i < len; i++)
+      sum += buf[i];
+
+   return sum;
+}
+
+static char copyChecksumScalar(char * dest, const char * src, int len)
+{
+   unsigned char sum = 0;
+   int i;
+
+   for(i = 0; i < len; i++)
+      sum += dest[i] = src[i];
+
+   return sum;
+}
+
+#ifdef KERNELS_X86
+//movemask gives 1 bit per byte that compared equal, so the first
+//zero bit is the first byte that didn't
+__attribute__((target("sse2")))
+static int firstNonBlankSSE2(const char * buf, int len)
+{
+   const __m128i ff = _mm_set1_epi8((char) 0xFF);
+   int i, m;
+
+   for(i = 0; i + 16 <= len; i += 16)
+   {
+      m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (buf + i)), ff));
+      if(m != 0xFFFF)
+         return i + __builtin_ctz(~m);
+   }
+   return i + firstNonBlankScalar(buf + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static int firstDifferenceSSE2(const char * a, const char * b, int len)
+{
+   int i, m;
+
+   for(i = 0; i + 16 <= len; i += 16)
+   {
+      m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (a + i)),
+                                           _mm_loadu_si128((const __m128i *) (b + i))));
+      if(m != 0xFFFF)
+         return i + __builtin_ctz(~m);
+   }
+   return i + firstDifferenceScalar(a + i, b + i, len - i);
+}
+
+//sad against zero adds each half of the 16 bytes into a 64 bit lane, only
+//the low byte of the total matters so the lanes can't overflow it
+__attribute__((target("sse2")))
+static unsigned int laneTotalSSE2(__m128i acc)
+{
+   return _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+}
+
+__attribute__((target("sse2")))
+static char checksumSSE2(const char * buf, int len)
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128i acc = zero;
+   int i;
+
+   for(i = 0; i + 16 <= len; i += 16)
+      acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i *) (buf + i)), zero));
+
+   return laneTotalSSE2(acc) + checksumScalar(buf + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static char copyChecksumSSE2(char * dest, const char * src, int len)
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128i acc = zero, v;
+   int i;
+
+   for(i = 0; i + 16 <= len; i += 16)
+   {
+      v = _mm_loadu_si128((const __m128i *) (src + i));
+      _mm_storeu_si128((__m128i *) (dest + i), v);
+      acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+   }
+
+   return laneTotalSSE2(acc) + copyChecksumScalar(dest + i, src + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static int firstNonBlankAVX2(const char * buf, int len)
+{
+   const __m256i ff = _mm256_set1_epi8((char) 0xFF);
+   unsigned int m;
+   int i;
+
+   for(i = 0; i + 32 <= len; i += 32)
+   {
+      m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (buf + i)), ff));
+      if(m != 0xFFFFFFFFu)
+         return i + __builtin_ctz(~m);
+   }
+   return i + firstNonBlankSSE2(buf + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static int firstDifferenceAVX2(const char * a, const char * b, int len)
+{
+   unsigned int m;
+   int i;
+
+   for(i = 0; i + 32 <= len; i += 32)
+   {
+      m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (a + i)),
+                                                 _mm256_loadu_si256((const __m256i *) (b + i))));
+      if(m != 0xFFFFFFFFu)
+         return i + __builtin_ctz(~m);
+   }
+   return i + firstDifferenceSSE2(a + i, b + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static unsigned int laneTotalAVX2(__m256i acc)
+{
+   return laneTotalSSE2(_mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+}
+
+__attribute__((target("avx2")))
+static char checksumAVX2(const char * buf, int len)
+{
+   const __m256i zero = _mm256_setzero_si256();
+   __m256i acc = zero;
+   int i;
+
+   for(i = 0; i + 32 <= len; i += 32)
+      acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i *) (buf + i)), zero));
+
+   return laneTotalAVX2(acc) + checksumSSE2(buf + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static char copyChecksumAVX2(char * dest, const char * src, int len)
+{
+   const __m256i zero = _mm256_setzero_si256();
+   __m256i acc = zero, v;
+   int i;
+
+   for(i = 0; i + 32 <= len; i += 32)
+   {
+      v = _mm256_loadu_si256((const __m256i *) (src + i));
+      _mm256_storeu_si256((__m256i *) (dest + i), v);
+      acc = _mm256_add_epi64(acc, _mm256_sad_epu8(v, zero));
+   }
+
+   return laneTotalAVX2(acc) + copyChecksumSSE2(dest + i, src + i, len - i);
+}
+#endif
+
+//The pointers start out at these, which pick the best version for
+//this CPU, swap themselves in and pass the call on.  They're only for
+//a call made by another file's static setup before this one's has run,
+//which is before main so there's only one thread
+static int firstNonBlankPick(const char *, int);
+static int firstDifferencePick(const char *, const char *, int);
+static char checksumPick(const char *, int);
+static char copyChecksumPick(char *, const char *, int);
+
+static firstNonBlankFunc firstNonBlankImpl = firstNonBlankPick;
+static firstDifferenceFunc firstDifferenceImpl = firstDifferencePick;
+static checksumFunc checksumImpl = checksumPick;
+static copyChecksumFunc copyChecksumImpl = copyChecksumPick;
+
+static void pickKernels(void)
+{
+#ifdef KERNELS_X86
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("avx2"))
+   {
+      firstNonBlankImpl = firstNonBlankAVX2;
+      firstDifferenceImpl = firstDifferenceAVX2;
+      checksumImpl = checksumAVX2;
+      copyChecksumImpl = copyChecksumAVX2;
+      return;
+   }
+   if(__builtin_cpu_supports("sse2"))
+   {
+      firstNonBlankImpl = firstNonBlankSSE2;
+      firstDifferenceImpl = firstDifferenceSSE2;
+      checksumImpl = checksumSSE2;
+      copyChecksumImpl = copyChecksumSSE2;
+      return;
+   }
+#endif
+   firstNonBlankImpl = firstNonBlankScalar;
+   firstDifferenceImpl = firstDifferenceScalar;
+   checksumImpl = checksumScalar;
+   copyChecksumImpl = copyChecksumScalar;
+}
+
+//picks during static setup, so the pointers are never written once
+//main has started threads
+static const bool kernelsPicked = (pickKernels(), true);
+
+static int firstNonBlankPick(const char * buf, int len)
+{
+   pickKernels();
+   return firstNonBlankImpl(buf, len);
+}
+
+static int firstDifferencePick(const char * a, const char * b, int len)
+{
+   pickKernels();
+   return firstDifferenceImpl(a, b, len);
+}
+
+static char checksumPick(const char * buf, int len)
+{
+   pickKernels();
+   return checksumImpl(buf, len);
+}
+
+static char copyChecksumPick(char * dest, const char * src, int len)
+{
+   pickKernels();
+   return copyChecksumImpl(dest, src, len);
+}
+
+bool Kernels::isBlank(const char * buf, int len)
+{
+   return firstNonBlankImpl(buf, len) == len;
+}
+
+bool Kernels::isEqual(const char * a, const char * b, int len)
+{
+   return firstDifferenceImpl(a, b, len) == len;
+}
+
+int Kernels::firstNonBlank(const char * buf, int len)
+{
+   if(len <= 0)
+      return 0;
+
+   return firstNonBlankImpl(buf, len);
+}
+
+int Kernels::firstDifference(const char * a, const char * b, int len)
+{
+   if(len <= 0)
+      return 0;
+
+   return firstDifferenceImpl(a, b, len);
+}
+
+char Kernels::checksum(const char * buf, int len)
+{
+   if(len <= 0)
+      return 0;
+
+   return checksumImpl(buf, len);
+}
+
+char Kernels::copyChecksum(char * dest, const char * src, int len)
+{
+   if(len <= 0)
+      return 0;
+
+   return copyChecksumImpl(dest, src, len);
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Buffer compare and checksum kernels shared by the Burn and Ostrich classes
+ *
+ * The verify and blank check paths spend their host time walking
+ * blocks looking for a byte that isn't what it should be, and every block
+ * sent or read is summed for its checksum.  These do that 16 or 32 bytes
+ * at a time with SSE2/AVX2 when the CPU has it, picked at runtime
+ * before main, and fall back to plain loops anywhere else.
+ *
+ */
+#include <config.h>
+
+class Kernels
+{
+
+public:
+   //returns true if every byte in the buffer is 0xFF
+   static bool isBlank(const char *, int);
+
+   //returns true if both buffers hold the same bytes
+   static bool isEqual(const char *, const char *, int);
+
+   //returns the index of the first byte that isn't 0xFF, or the length if none
+   static int firstNonBlank(const char *, int);
+
+   //returns the index of the first byte that differs between the buffers
+   //or the length if they match
+   static int firstDifference(const char *, const char *, int);
+
+   //returns the low byte of the sum of the bytes, the checksum both
+   //devices use
+   static char checksum(const char *, int);
+
+   //copies the bytes from the second buffer to the first and returns
+   //their checksum, in one pass
+   static char copyChecksum(char *, const char *, int);
+};
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Batch job manifest, see Manifest.h
+ */
+#include "Manifest.h"
+#include "FieldFile.h"
+#include "Timer.h"
+#include "Thread.h"
+#include <sstream>
+
+bool Manifest::setFile(std::string s)
+{
+   manifestFile = s;
+   return true;
+}
+
+std::string Manifest::getFile(void)
+{
+   return manifestFile;
+}
+
+//A line needs device, chip, action and file, the bank is optional
+bool Manifest::load(void)
+{
+   FieldFile in;
+   std::vector<std::string> f;
+   std::ostringstream err;
+   ManifestJob job;
+
+   jobs.clear();
+   error.clear();
+
+   if(!in.open(manifestFile))
+   {
+      error = "couldn't open " + manifestFile;
+      return false;
+   }
+
+   while(in.next(f))
+   {
+      if(f.size() < 4)
+      {
+         err << "line " << in.getLine() << ": needs device, chip, action and file";
+         break;
+      }
+      job.device = f[0];
+      job.chip = f[1];
+      job.action = f[2];
+      job.file = f[3];
+
+      job.bank = -1;
+      if(f.size() > 4 && f[4] != "-" && !FieldFile::parseBank(f[4], job.bank))
+      {
+         err << "line " << in.getLine() << ": bad bank " << f[4];
+         break;
+      }
+      if(f.size() > 5)
+      {
+         err << "line " << in.getLine() << ": too many fields";
+         break;
+      }
+
+      job.line = in.getLine();
+      job.done = job.ok = false;
+      job.millis = 0;
+      job.message.clear();
+      jobs.push_back(job);
+   }
+
+   if(!err.str().empty())
+   {
+      error = err.str();
+      jobs.clear();
+      return false;
+   }
+   if(jobs.empty())
+   {
+      error = manifestFile + " has no jobs in it";
+      return false;
+   }
+   return true;
+}
+
+std::string Manifest::getError(void)
+{
+   return error;
+}
+
+std::vector<ManifestJob> Manifest::getJobs(void)
+{
+   return jobs;
+}
+
+std::vector<std::string> Manifest::getDevices(void)
+{
+   std::vector<std::string> devices;
+   unsigned int i, j;
+
+   for(i = 0; i < jobs.size(); i++)
+   {
+      for(j = 0; j < devices.size() && devices[j] != jobs[i].device; j++)
+         ;
+      if(j == devices.size())
+         devices.push_back(jobs[i].device);
+   }
+   return devices;
+}
+
+//Jobs are handed out by pointer so each thread fills in its own in place,
+//jobs isn't touched otherwise until they're all joined
+//a device whose thread can't be started is run on this one at the end
+bool Manifest::run(DeviceRunner runner, void * arg)
+{
+   std::vector<std::string> devices = getDevices();
+   std::vector<Worker> workers(devices.size());
+   std::vector<Thread> threads(devices.size());
+   long begin = Timer::currentMillis();
+   unsigned int i, j;
+
+   for(i = 0; i < jobs.size(); i++)
+   {
+      jobs[i].done = jobs[i].ok = false;
+      jobs[i].millis = 0;
+      jobs[i].message.clear();
+   }
+
+   for(i = 0; i < devices.size(); i++)
+   {
+      workers[i].runner = runner;
+      workers[i].arg = arg;
+      workers[i].device = devices[i];
+      for(j = 0; j < jobs.size(); j++)
+         if(jobs[j].device == devices[i])
+            workers[i].jobs.push_back(&jobs[j]);
+   }
+
+   for(i = 0; i < devices.size(); i++)
+      threads[i].start(start, &workers[i]);
+
+   for(i = 0; i < devices.size(); i++)
+      if(!threads[i].isStarted())
+         start(&workers[i]);
+
+   for(i = 0; i < devices.size(); i++)
+      threads[i].join();
+
+   elapsed = Timer::currentMillis() - begin;
+
+   for(i = 0; i < jobs.size(); i++)
+      if(!jobs[i].done || !jobs[i].ok)
+         return false;
+   return true;
+}
+
+void * Manifest::start(void * arg)
+{
+   Worker * w = (Worker *) arg;
+
+   w->runner(w->device, w->jobs, w->arg);
+   return NULL;
+}
+
+long Manifest::getElapsed(void)
+{
+   return elapsed;
+}
+
+Manifest::Manifest(void)
+{
+   elapsed = 0;
+}
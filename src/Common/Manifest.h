@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Batch job manifest shared by burn and ostrich
+ *
+ * A manifest is a text file with one job per line:
+ *
+ *    <device> <chip type> <action> <file> [bank]
+ *
+ * Fields are split on whitespace, anything after a # is a comment and
+ * blank lines are skipped, see FieldFile.h.  A manifest with no jobs
+ * in it is taken to be a mistake and doesn't load.  A - stands in for a field that doesn't
+ * apply, like the file for an erase or the chip type on an ostrich.
+ * What the chip types and actions mean is left to the program running
+ * the jobs, the manifest only checks that each line has its fields.
+ *
+ * Jobs for the same device run one after the other in the order they're
+ * listed, each device gets its own thread so different devices run at the
+ * same time.  Nothing is shared between devices so there's no locking.
+ *
+ */
+#include <config.h>
+#include <string>
+#include <vector>
+
+//One line of the manifest and how it went once it's been run
+struct ManifestJob
+{
+   //line of the manifest the job came from
+   int line;
+   std::string device;
+   std::string chip;
+   std::string action;
+   std::string file;
+   //-1 if no bank was given
+   int bank;
+
+   //filled in by whatever runs the job
+   bool done;
+   bool ok;
+   long millis;
+   std::string message;
+};
+
+class Manifest
+{
+
+public:
+   //Called on its own thread with the device and its jobs in manifest
+   //order, the last arg is whatever was passed to run, it should fill in
+   //the results of each job it runs, returning false stops that device
+   typedef bool (*DeviceRunner)(std::string, std::vector<ManifestJob *> &, void *);
+
+   //sets the manifest file
+   bool setFile(std::string);
+
+   //gets the manifest file
+   std::string getFile(void);
+
+   //reads and parses the manifest, on failure getError says where
+   bool load(void);
+
+   //returns what was wrong with the manifest the last load failed on
+   std::string getError(void);
+
+   //returns the jobs, with their results once it's been run
+   std::vector<ManifestJob> getJobs(void);
+
+   //returns the devices in the order they first show up
+   std::vector<std::string> getDevices(void);
+
+   //runs the jobs for each device on its own thread and waits for all of
+   //them, returns true only if every job ran and worked
+   bool run(DeviceRunner, void *);
+
+   //ms from the first device starting to the last one finishing
+   long getElapsed(void);
+
+   //Constructor
+   Manifest(void);
+
+private:
+   //what each thread gets handed
+   struct Worker
+   {
+      DeviceRunner runner;
+      void * arg;
+      std::string device;
+      std::vector<ManifestJob *> jobs;
+   };
+
+   //thread entry, hands the device's jobs to the runner
+   static void * start(void *);
+
+   std::string manifestFile;
+   std::string error;
+   std::vector<ManifestJob> jobs;
+   long elapsed;
+};
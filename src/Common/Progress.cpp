@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Progress reports, see Progress.h
+ */
+#include "Progress.h"
+#include "Timer.h"
+#include <stddef.h>
+
+ProgressObserver::~ProgressObserver()
+{
+}
+
+bool ProgressMeter::setObserver(ProgressObserver * o)
+{
+   observer = o;
+   return true;
+}
+
+ProgressObserver * ProgressMeter::getObserver(void)
+{
+   return observer;
+}
+
+void ProgressMeter::start(const char * phase, long total, int retries)
+{
+   PhaseTime p;
+
+   started = sampleMillis = Timer::currentMillis();
+   sampleDone = 0;
+   retriesAtStart = retries;
+
+   now.phase = phase;
+   now.done = 0;
+   now.total = total;
+   now.address = 0;
+   now.elapsed = 0;
+   now.rate = now.averageRate = 0;
+   now.eta = -1;
+   now.retries = 0;
+
+   p.phase = phase;
+   p.millis = p.bytes = 0;
+   p.retries = 0;
+   phases.push_back(p);
+
+   if(observer != NULL)
+      observer->progress(now);
+}
+
+//The current rate is only worked out again once a window has gone by,
+//a block at a time is far too jumpy to be any use
+bool ProgressMeter::update(long done, int address, int retries)
+{
+   bool go = true;
+   long t;
+
+   t = Timer::currentMillis();
+   now.done = done;
+   now.address = address;
+   now.retries = retries - retriesAtStart;
+   now.elapsed = t - started;
+
+   if(now.elapsed > 0)
+      now.averageRate = now.done * 1000.0 / now.elapsed;
+
+   if(t - sampleMillis >= rateWindow)
+   {
+      now.rate = (done - sampleDone) * 1000.0 / (t - sampleMillis);
+      sampleMillis = t;
+      sampleDone = done;
+   }
+   else if(now.rate == 0)
+      now.rate = now.averageRate;
+
+   if(now.averageRate > 0)
+      now.eta = (long) ((now.total - now.done) * 1000.0 / now.averageRate);
+
+   if(!phases.empty())
+   {
+      phases.back().millis = now.elapsed;
+      phases.back().bytes = done;
+      phases.back().retries = now.retries;
+   }
+
+   if(observer != NULL)
+      observer->progress(now);
+
+   //stopped is only the record of it, a cleared deadline lets the next
+   //transfer run
+   stopLock.lock();
+   if(cancelled || (deadline && t >= deadline))
+      go = false;
+   stopped = stopped || !go;
+   stopLock.unlock();
+   return go;
+}
+
+bool ProgressMeter::cancel(void)
+{
+   stopLock.lock();
+   cancelled = true;
+   stopLock.unlock();
+   return true;
+}
+
+bool ProgressMeter::setDeadline(long ms)
+{
+   long d = ms > 0 ? Timer::currentMillis() + ms : 0;
+
+   stopLock.lock();
+   deadline = d;
+   cancelled = stopped = false;
+   stopLock.unlock();
+   return true;
+}
+
+bool ProgressMeter::clearDeadline(void)
+{
+   stopLock.lock();
+   deadline = 0;
+   cancelled = false;
+   stopLock.unlock();
+   return true;
+}
+
+bool ProgressMeter::wasStopped(void)
+{
+   bool s;
+
+   stopLock.lock();
+   s = stopped;
+   stopLock.unlock();
+   return s;
+}
+
+const std::vector<PhaseTime> & ProgressMeter::getPhases(void)
+{
+   return phases;
+}
+
+bool ProgressMeter::clearPhases(void)
+{
+   phases.clear();
+   return true;
+}
+
+ProgressMeter::ProgressMeter(void)
+{
+   observer = NULL;
+   started = sampleMillis = sampleDone = 0;
+   retriesAtStart = 0;
+   cancelled = stopped = false;
+   deadline = 0;
+   now.phase = "";
+   now.done = now.total = now.elapsed = 0;
+   now.address = now.retries = 0;
+   now.rate = now.averageRate = 0;
+   now.eta = -1;
+}
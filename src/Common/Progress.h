@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Progress reports from long reads, writes and verifies
+ *
+ * Burn and Ostrich hand a Progress to their observer, if one is set,
+ * after every block of a write, read, verify or blank check.  The
+ * meter does the sums, rates are in bytes a second, the current one
+ * over about the last half second and the average over the whole
+ * phase, the ETA goes by the average.  Observers are called on the
+ * thread doing the work and shouldn't take long about it.
+ *
+ * Whether anyone's watching or not the meter keeps how long each phase
+ * took, up to its last block, for the timing reports.
+ *
+ * Since it hears about every block the meter is also where a transfer
+ * finds out it's been cancelled or has run past its deadline, update
+ * returns false and the transfer gives up as if the block had failed.
+ *
+ */
+#include <config.h>
+#include <vector>
+#include "Thread.h"
+
+struct Progress
+{
+   //what's being done, "write", "read", "verify" or "blank check"
+   const char * phase;
+   long done;
+   long total;
+   //chip or bank address of the last block
+   int address;
+   //ms since the phase started
+   long elapsed;
+   double rate;
+   double averageRate;
+   //ms left at the average rate, -1 until there's a rate to go by
+   long eta;
+   //retries since the phase started
+   int retries;
+};
+
+//How one phase went, kept in the order they ran
+struct PhaseTime
+{
+   const char * phase;
+   long millis;
+   long bytes;
+   int retries;
+};
+
+class ProgressObserver
+{
+
+public:
+   //called after each block, and once at the start of each phase
+   virtual void progress(const Progress &) = 0;
+
+   virtual ~ProgressObserver();
+};
+
+class ProgressMeter
+{
+
+public:
+   //sets who gets told, NULL turns reporting off
+   bool setObserver(ProgressObserver *);
+   ProgressObserver * getObserver(void);
+
+   //starts a phase of the number of bytes in the 2nd arg, the 3rd is
+   //the owner's retry count so far, retries are counted from there
+   void start(const char *, long, int);
+
+   //reports the bytes done so far, the address of the last block and
+   //the owner's retry count, false if the transfer should stop
+   bool update(long, int, int);
+
+   //stops transfers at the next block, safe from any thread
+   bool cancel(void);
+
+   //stops transfers at the next block once the ms passed have gone by,
+   //0 for never, clears any earlier cancel
+   bool setDeadline(long);
+
+   //drops the deadline and any cancel that came too late to stop
+   //anything, without touching wasStopped
+   bool clearDeadline(void);
+
+   //true if a transfer was stopped by a cancel or the deadline since
+   //the deadline was last set
+   bool wasStopped(void);
+
+   //the phases since the last clear
+   const std::vector<PhaseTime> & getPhases(void);
+   bool clearPhases(void);
+
+   ProgressMeter(void);
+
+private:
+   //how long the current rate is measured over, in ms
+   static const long rateWindow = 500;
+
+   ProgressObserver * observer;
+   std::vector<PhaseTime> phases;
+   Progress now;
+   long started;
+   long sampleMillis;
+   long sampleDone;
+   int retriesAtStart;
+   //cancelled, stopped and deadline are set from other threads, so
+   //they're only touched holding this
+   Mutex stopLock;
+   bool cancelled;
+   bool stopped;
+   long deadline;
+};
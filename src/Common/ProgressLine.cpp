@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Live progress line, see ProgressLine.h
+ */
+#include "Progress.h"
+#include "ProgressLine.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <iostream>
+#ifdef WIN32
+#include <io.h>
+#define isatty _isatty
+#else
+#include <unistd.h>
+#endif
+
+bool ProgressLine::setLabel(std::string s)
+{
+   label = s;
+   lastPhase.clear();
+   return true;
+}
+
+void ProgressLine::progress(const Progress & p)
+{
+   char buf[160];
+   long t = Timer::currentMillis();
+   int n;
+
+   if(!enabled)
+      return;
+
+   //the last block of a phase is always drawn so it ends on 100%
+   if(lastPhase == p.phase && p.done < p.total && t - lastDrawn < redrawInterval)
+      return;
+   lastPhase = p.phase;
+   lastDrawn = t;
+
+   n = snprintf(buf, sizeof(buf), "%s %ld/%ld %3d%% @0x%05x %.1f KB/s (avg %.1f)",
+                p.phase, p.done, p.total, p.total > 0 ? (int) (p.done * 100 / p.total) : 0,
+                p.address, p.rate / 1024, p.averageRate / 1024);
+   if(p.eta >= 0 && n < (int) sizeof(buf))
+      n += snprintf(buf + n, sizeof(buf) - n, " ETA %ld:%02ld", p.eta / 60000, (p.eta / 1000) % 60);
+   if(p.retries > 0 && n < (int) sizeof(buf))
+      n += snprintf(buf + n, sizeof(buf) - n, " retries %d", p.retries);
+   if(n >= (int) sizeof(buf))
+      n = sizeof(buf) - 1;
+
+   //pad out anything left over from a longer line
+   std::cerr << "\r" << label << buf;
+   if(n < width)
+      std::cerr << std::string(width - n, ' ');
+   std::cerr << std::flush;
+   if(n > width)
+      width = n;
+}
+
+void ProgressLine::finish(void)
+{
+   if(!enabled || width == 0)
+      return;
+
+   std::cerr << "\r" << label << std::string(width, ' ') << "\r" << label << std::flush;
+   width = 0;
+   lastPhase.clear();
+}
+
+bool ProgressLine::isEnabled(void)
+{
+   return enabled;
+}
+
+ProgressLine::ProgressLine(void)
+{
+   lastDrawn = 0;
+   width = 0;
+   enabled = isatty(1) && isatty(2);
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Live progress line for the command line tools
+ *
+ * Redraws a single line on stderr with how far the current phase has
+ * got, where on the chip it is, the current and average rates, the
+ * time left and any retries, so a slow burn can be told from a hung
+ * one.  The label, normally whatever the tool already printed on that
+ * line, is redrawn in front of it and left on its own by finish so the
+ * result can follow it.  Nothing is drawn unless stdout and stderr are
+ * both a terminal, otherwise the label wouldn't be on the same line.
+ * Progress.h has to be included first, Burn.h and Ostrich.h do that.
+ *
+ */
+#include <config.h>
+#include <string>
+
+class ProgressLine : public ProgressObserver
+{
+
+public:
+   //sets the text drawn in front of the progress
+   bool setLabel(std::string);
+
+   //draws the line, at most every redrawInterval ms unless the phase changed
+   void progress(const Progress &);
+
+   //wipes the progress off, leaving the label
+   void finish(void);
+
+   //true if there's a terminal to draw on
+   bool isEnabled(void);
+
+   ProgressLine(void);
+
+private:
+   static const long redrawInterval = 200;
+
+   std::string label;
+   std::string lastPhase;
+   long lastDrawn;
+   int width;
+   bool enabled;
+};
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Timing report, see StatsReport.h
+ */
+#include "Progress.h"
+#include "StatsReport.h"
+#include "Timer.h"
+#include <stdio.h>
+
+bool StatsReport::setEnabled(bool b)
+{
+   enabled = b;
+   return true;
+}
+
+bool StatsReport::isEnabled(void)
+{
+   return enabled;
+}
+
+bool StatsReport::setTool(std::string s)
+{
+   tool = s;
+   return true;
+}
+
+bool StatsReport::setPort(std::string s)
+{
+   port = s;
+   return true;
+}
+
+bool StatsReport::setAction(std::string s)
+{
+   action = s;
+   return true;
+}
+
+bool StatsReport::setTarget(std::string s)
+{
+   target = s;
+   return true;
+}
+
+bool StatsReport::setFile(std::string s)
+{
+   file = s;
+   return true;
+}
+
+bool StatsReport::addPhase(const char * phase, long from)
+{
+   PhaseTime p;
+
+   p.phase = phase;
+   p.millis = Timer::currentMillis() - from;
+   p.bytes = 0;
+   p.retries = 0;
+   phases.push_back(p);
+   return true;
+}
+
+bool StatsReport::addPhases(const std::vector<PhaseTime> & v)
+{
+   phases.insert(phases.end(), v.begin(), v.end());
+   return true;
+}
+
+bool StatsReport::setBytes(long sent, long received)
+{
+   bytesSent = sent;
+   bytesReceived = received;
+   return true;
+}
+
+bool StatsReport::setRetries(int r, int b)
+{
+   retries = r;
+   blocksRetried = b;
+   return true;
+}
+
+bool StatsReport::setResult(bool b)
+{
+   ok = b;
+   return true;
+}
+
+bool StatsReport::writeJson(std::ostream & out)
+{
+   long elapsed = Timer::currentMillis() - started;
+
+   if(!enabled)
+      return false;
+
+   out << "{\"tool\":" << quote(tool)
+       << ",\"port\":" << quote(port)
+       << ",\"action\":" << quote(action)
+       << ",\"target\":" << quote(target)
+       << ",\"file\":" << quote(file)
+       << ",\"ok\":" << (ok ? "true" : "false")
+       << ",\"elapsed_ms\":" << elapsed
+       << ",\"phases\":[";
+   for(unsigned int i = 0; i < phases.size(); i++)
+   {
+      out << (i ? "," : "")
+          << "{\"phase\":" << quote(phases[i].phase)
+          << ",\"ms\":" << phases[i].millis
+          << ",\"bytes\":" << phases[i].bytes
+          << ",\"bytes_per_sec\":" << (phases[i].millis > 0 ? phases[i].bytes * 1000 / phases[i].millis : 0)
+          << ",\"retries\":" << phases[i].retries << "}";
+   }
+   //the effective rate counts everything that went over the port
+   out << "],\"bytes_sent\":" << bytesSent
+       << ",\"bytes_received\":" << bytesReceived
+       << ",\"bytes_per_sec\":" << (elapsed > 0 ? (bytesSent + bytesReceived) * 1000 / elapsed : 0)
+       << ",\"retries\":" << retries
+       << ",\"blocks_retried\":" << blocksRetried
+       << "}" << std::endl;
+
+   return out.good();
+}
+
+std::string StatsReport::quote(std::string s)
+{
+   std::string r = "\"";
+   char tmp[8];
+
+   for(unsigned int i = 0; i < s.size(); i++)
+   {
+      if(s[i] == '"' || s[i] == '\\')
+         r += '\\';
+      if((unsigned char) s[i] < 0x20)
+      {
+         snprintf(tmp, sizeof(tmp), "\\u%04x", (unsigned char) s[i]);
+         r += tmp;
+      }
+      else
+         r += s[i];
+   }
+   return r + "\"";
+}
+
+StatsReport::StatsReport(void)
+{
+   enabled = ok = false;
+   bytesSent = bytesReceived = 0;
+   retries = blocksRetried = 0;
+   started = Timer::currentMillis();
+}
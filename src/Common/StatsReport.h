@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Timing report for the command line tools
+ *
+ * Collects how long each phase of a job took, opening the port and
+ * finding the hardware as timed by the tool plus whatever a Burn or
+ * Ostrich kept of its own, with the bytes that went over the wire and
+ * the retries, and writes it all out as one line of JSON for whatever
+ * is keeping an eye on the stations.  Rates are in bytes a second.
+ * Progress.h has to be included first, Burn.h and Ostrich.h do that.
+ *
+ */
+#include <config.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+class StatsReport
+{
+
+public:
+   //nothing gets written unless the report is enabled
+   bool setEnabled(bool);
+   bool isEnabled(void);
+
+   //what ran where, the target is the chip or bank, the file can be empty
+   bool setTool(std::string);
+   bool setPort(std::string);
+   bool setAction(std::string);
+   bool setTarget(std::string);
+   bool setFile(std::string);
+
+   //adds a phase the tool timed itself, from the time in the 2nd arg to now
+   bool addPhase(const char *, long);
+
+   //adds the phases a Burn or Ostrich kept
+   bool addPhases(const std::vector<PhaseTime> &);
+
+   //bytes sent and received over the port
+   bool setBytes(long, long);
+
+   //retries and blocks that needed them
+   bool setRetries(int, int);
+
+   bool setResult(bool);
+
+   //writes the report as a single line JSON object, timed from construction
+   bool writeJson(std::ostream &);
+
+   StatsReport(void);
+
+private:
+   //quotes and escapes a string for JSON
+   std::string quote(std::string);
+
+   bool enabled;
+   bool ok;
+   std::string tool;
+   std::string port;
+   std::string action;
+   std::string target;
+   std::string file;
+   std::vector<PhaseTime> phases;
+   long bytesSent;
+   long bytesReceived;
+   int retries;
+   int blocksRetried;
+   long started;
+};
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Block streaming to a file, see StreamWriter.h
+ */
+#include "StreamWriter.h"
+#include "BufferPool.h"
+#include <stdio.h>
+#ifdef WIN32
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+
+//The blocks go to a temporary file next to the target, which only
+//replaces it once everything is in, so a read that fails part way
+//leaves whatever was there before alone
+static FILE * openTemp(std::string s, std::string & tmp)
+{
+   char suffix[32];
+   FILE * f;
+#ifdef WIN32
+   long pid = (long) GetCurrentProcessId();
+#else
+   long pid = (long) getpid();
+#endif
+
+   for(int i = 0; i < 100; i++)
+   {
+      snprintf(suffix, sizeof(suffix), ".%ld.%d.tmp", pid, i);
+      tmp = s + suffix;
+      if((f = fopen(tmp.c_str(), "rb")) != NULL)
+      {
+         fclose(f);
+         continue;
+      }
+      return fopen(tmp.c_str(), "wb");
+   }
+   return NULL;
+}
+
+bool StreamWriter::open(std::string s, int size)
+{
+   if(running || size <= 0)
+      return false;
+
+   if(s == "-")
+   {
+      out = stdout;
+#ifdef WIN32
+      _setmode(_fileno(stdout), _O_BINARY);
+#endif
+   }
+   else if((out = openTemp(s, tmpName)) == NULL)
+      return false;
+
+   if((buf = BufferPool::acquire(slots * size)) == NULL)
+   {
+      if(out != stdout)
+      {
+         fclose(out);
+         remove(tmpName.c_str());
+      }
+      out = NULL;
+      return false;
+   }
+
+   name = s;
+   slotSize = size;
+   head = queued = 0;
+   stopping = dropping = failed = false;
+   if(!thread.start(run, this))
+   {
+      stop(true);
+      if(out != stdout)
+      {
+         fclose(out);
+         remove(tmpName.c_str());
+      }
+      out = NULL;
+      return false;
+   }
+   return running = true;
+}
+
+char * StreamWriter::getSlot(void)
+{
+   char * slot = NULL;
+
+   if(!running)
+      return NULL;
+
+   lock.lock();
+   while(queued == slots && !failed)
+      changed.wait(lock);
+   if(!failed)
+      slot = buf + ((head + queued) % slots) * slotSize;
+   lock.unlock();
+   return slot;
+}
+
+bool StreamWriter::commit(int len)
+{
+   bool ok;
+
+   if(!running || len < 0 || len > slotSize)
+      return false;
+
+   lock.lock();
+   if((ok = !failed && queued < slots))
+   {
+      lengths[(head + queued) % slots] = len;
+      queued++;
+      changed.broadcast();
+   }
+   lock.unlock();
+   return ok;
+}
+
+bool StreamWriter::close(void)
+{
+   bool ok;
+
+   if(!running)
+      return false;
+
+   stop(false);
+   ok = !failed;
+   if(out == stdout)
+      ok = fflush(out) == 0 && ok;
+   else
+   {
+      if(fclose(out) != 0)
+         ok = false;
+#ifdef WIN32
+      //windows won't rename over a file that's there
+      if(ok)
+         remove(name.c_str());
+#endif
+      if(!ok || rename(tmpName.c_str(), name.c_str()) != 0)
+      {
+         remove(tmpName.c_str());
+         ok = false;
+      }
+   }
+   out = NULL;
+   return ok;
+}
+
+bool StreamWriter::abort(void)
+{
+   if(!running)
+      return false;
+
+   stop(true);
+   if(out != stdout)
+   {
+      fclose(out);
+      remove(tmpName.c_str());
+   }
+   out = NULL;
+   return true;
+}
+
+bool StreamWriter::isOpen(void)
+{
+   return running;
+}
+
+//Writes outside the lock so the reader can queue the next block
+void * StreamWriter::run(void * p)
+{
+   StreamWriter * w = (StreamWriter *) p;
+   const char * cp;
+   int left;
+   bool ok;
+
+   w->lock.lock();
+   for(;;)
+   {
+      while(w->queued == 0 && !w->stopping)
+         w->changed.wait(w->lock);
+      if(w->dropping || w->queued == 0)
+         break;
+
+      cp = w->buf + w->head * w->slotSize;
+      left = w->lengths[w->head];
+      w->lock.unlock();
+
+      //whatever's downstream of stdout gets each block as it comes
+      ok = fwrite(cp, 1, left, w->out) == (size_t) left &&
+           (w->out != stdout || fflush(w->out) == 0);
+
+      w->lock.lock();
+      w->head = (w->head + 1) % slots;
+      w->queued--;
+      if(!ok)
+      {
+         w->failed = true;
+         w->dropping = true;
+      }
+      w->changed.broadcast();
+   }
+   w->lock.unlock();
+   return NULL;
+}
+
+void StreamWriter::stop(bool drop)
+{
+   if(running)
+   {
+      lock.lock();
+      stopping = true;
+      if(drop)
+         dropping = true;
+      changed.broadcast();
+      lock.unlock();
+      thread.join();
+      running = false;
+   }
+   BufferPool::release(buf);
+   buf = NULL;
+}
+
+StreamWriter::StreamWriter(void)
+{
+   out = NULL;
+   buf = NULL;
+   slotSize = 0;
+   head = queued = 0;
+   stopping = dropping = failed = running = false;
+}
+
+//Anything still open wasn't finished, so it's thrown away
+StreamWriter::~StreamWriter(void)
+{
+   abort();
+}
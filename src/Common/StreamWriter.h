@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Streams blocks to a file from a writer thread
+ *
+ * A read off the hardware hands each block to the writer as soon as
+ * it's in and goes straight on to the next one while the writer puts it
+ * on disk, or down a pipe if the file is "-" for stdout.  Blocks are
+ * read straight into one of a few slots, so no more than that many are
+ * ever held, a reader that gets that far ahead waits for the writer.
+ * Slots come from the BufferPool.
+ *
+ * A file is written under a temporary name beside it and only renamed
+ * over the real one by close, so a read that fails leaves an existing
+ * file as it was.
+ *
+ * Only one thread should be handing blocks in.
+ *
+ */
+#include <config.h>
+#include <string>
+#include <stdio.h>
+#include "Thread.h"
+
+class StreamWriter
+{
+
+public:
+   //opens the file, "-" for stdout, with slots for blocks of up to the
+   //size passed, and starts the writer
+   bool open(std::string, int);
+
+   //waits for a free slot and returns it to read a block into, NULL if
+   //it isn't open or a write has failed
+   char * getSlot(void);
+
+   //queues the number of bytes passed from the start of the slot that
+   //getSlot returned, false if a write has failed
+   bool commit(int);
+
+   //waits for everything queued to be written, closes the file and puts
+   //it in place, false if any of it couldn't be
+   bool close(void);
+
+   //stops without writing what's left and removes the temporary file,
+   //the target is untouched, stdout is just left where it got to
+   bool abort(void);
+
+   bool isOpen(void);
+
+   StreamWriter(void);
+   ~StreamWriter(void);
+
+private:
+   //the writer thread and the slots are owned, they can't be copied
+   StreamWriter(const StreamWriter &);
+   StreamWriter & operator=(const StreamWriter &);
+
+   //thread entry, writes slots out in order until told to stop
+   static void * run(void *);
+
+   //stops the writer, after what's queued unless it's dropped, and
+   //gives the slots back
+   void stop(bool);
+
+   //a few blocks is plenty to keep the port busy while the disk catches up
+   static const int slots = 4;
+
+   std::string name;
+   std::string tmpName;
+   FILE * out;
+   char * buf;
+   int slotSize;
+   int lengths[slots];
+   //next slot to write and the number queued after it
+   int head;
+   int queued;
+   bool stopping;
+   bool dropping;
+   bool failed;
+   bool running;
+   Thread thread;
+   Mutex lock;
+   Condition changed;
+};
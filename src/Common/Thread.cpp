@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Threads, locks and condition variables, see Thread.h
+ */
+#include "Thread.h"
+#ifndef WIN32
+#include <time.h>
+#include <errno.h>
+#endif
+
+#ifdef WIN32
+Mutex::Mutex(void) { InitializeCriticalSection(&cs); }
+Mutex::~Mutex(void) { DeleteCriticalSection(&cs); }
+void Mutex::lock(void) { EnterCriticalSection(&cs); }
+void Mutex::unlock(void) { LeaveCriticalSection(&cs); }
+
+Condition::Condition(void) { InitializeConditionVariable(&cv); }
+Condition::~Condition(void) { }
+void Condition::wait(Mutex & m) { SleepConditionVariableCS(&cv, &m.cs, INFINITE); }
+void Condition::broadcast(void) { WakeAllConditionVariable(&cv); }
+
+bool Condition::waitFor(Mutex & m, long ms)
+{
+   return ms > 0 && SleepConditionVariableCS(&cv, &m.cs, ms);
+}
+
+DWORD WINAPI Thread::trampoline(LPVOID p)
+{
+   Thread * t = (Thread *) p;
+
+   t->entry(t->arg);
+   return 0;
+}
+
+//the Thread has to stay put until the new thread is running its entry,
+//which is true of everything here as they're all joined before going away
+bool Thread::start(Entry e, void * a)
+{
+   if(started)
+      return false;
+
+   entry = e;
+   arg = a;
+   if((handle = CreateThread(NULL, 0, trampoline, this, 0, NULL)) == NULL)
+      return false;
+
+   return started = true;
+}
+
+bool Thread::join(void)
+{
+   if(!started)
+      return false;
+
+   WaitForSingleObject(handle, INFINITE);
+   CloseHandle(handle);
+   started = false;
+   return true;
+}
+
+Thread::Thread(void)
+{
+   handle = NULL;
+   entry = NULL;
+   arg = NULL;
+   started = false;
+}
+#else
+Mutex::Mutex(void) { pthread_mutex_init(&m, NULL); }
+Mutex::~Mutex(void) { pthread_mutex_destroy(&m); }
+void Mutex::lock(void) { pthread_mutex_lock(&m); }
+void Mutex::unlock(void) { pthread_mutex_unlock(&m); }
+
+//Timed waits go by the same monotonic clock as Timer where the condition
+//can be told to, so setting the time of day doesn't stretch them
+#if defined(HAVE_PTHREAD_CONDATTR_SETCLOCK) && defined(CLOCK_MONOTONIC)
+static const clockid_t waitClock = CLOCK_MONOTONIC;
+#else
+static const clockid_t waitClock = CLOCK_REALTIME;
+#endif
+
+Condition::Condition(void)
+{
+   pthread_condattr_t attr;
+
+   pthread_condattr_init(&attr);
+#if defined(HAVE_PTHREAD_CONDATTR_SETCLOCK) && defined(CLOCK_MONOTONIC)
+   pthread_condattr_setclock(&attr, waitClock);
+#endif
+   pthread_cond_init(&c, &attr);
+   pthread_condattr_destroy(&attr);
+}
+
+Condition::~Condition(void) { pthread_cond_destroy(&c); }
+void Condition::wait(Mutex & m) { pthread_cond_wait(&c, &m.m); }
+void Condition::broadcast(void) { pthread_cond_broadcast(&c); }
+
+//timedwait wants a time on the condition's clock to stop at
+bool Condition::waitFor(Mutex & m, long ms)
+{
+   struct timespec until;
+
+   if(ms <= 0)
+      return false;
+
+   clock_gettime(waitClock, &until);
+   until.tv_sec += ms / 1000;
+   until.tv_nsec += (ms % 1000) * 1000000L;
+   if(until.tv_nsec >= 1000000000L)
+   {
+      until.tv_sec++;
+      until.tv_nsec -= 1000000000L;
+   }
+   return pthread_cond_timedwait(&c, &m.m, &until) != ETIMEDOUT;
+}
+
+bool Thread::start(Entry e, void * a)
+{
+   if(started)
+      return false;
+
+   return started = pthread_create(&thread, NULL, e, a) == 0;
+}
+
+bool Thread::join(void)
+{
+   if(!started)
+      return false;
+
+   pthread_join(thread, NULL);
+   started = false;
+   return true;
+}
+
+Thread::Thread(void)
+{
+   started = false;
+}
+#endif
+
+bool Thread::isStarted(void)
+{
+   return started;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Threads, locks and condition variables for the Burn and Ostrich classes
+ *
+ * Hides the difference between pthreads and the windows calls, the
+ * same way Timer does for the clock.  Only what the classes here need
+ * is covered: starting and joining a thread, a plain lock, and waiting
+ * on a condition with or without a time limit.
+ *
+ * Several headers hold these by value, so unlike the rest this one
+ * guards against being included twice.
+ *
+ */
+#ifndef THREAD_H
+#define THREAD_H
+#include <config.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+class Mutex
+{
+
+public:
+   void lock(void);
+   void unlock(void);
+
+   Mutex(void);
+   ~Mutex(void);
+
+private:
+   //locks can't be copied
+   Mutex(const Mutex &);
+   Mutex & operator=(const Mutex &);
+
+   friend class Condition;
+#ifdef WIN32
+   CRITICAL_SECTION cs;
+#else
+   pthread_mutex_t m;
+#endif
+};
+
+class Condition
+{
+
+public:
+   //releases the lock, which must be held, waits to be woken and takes
+   //it again, can wake up with nothing changed so check in a loop
+   void wait(Mutex &);
+
+   //same but gives up once the ms passed have gone by, false if it did
+   bool waitFor(Mutex &, long);
+
+   //wakes everything waiting
+   void broadcast(void);
+
+   Condition(void);
+   ~Condition(void);
+
+private:
+   Condition(const Condition &);
+   Condition & operator=(const Condition &);
+
+#ifdef WIN32
+   CONDITION_VARIABLE cv;
+#else
+   pthread_cond_t c;
+#endif
+};
+
+class Thread
+{
+
+public:
+   typedef void * (*Entry)(void *);
+
+   //runs the function on a new thread with the arg passed, false if
+   //one is already running here or it couldn't be started
+   bool start(Entry, void *);
+
+   //waits for the thread to finish, false if none was started
+   bool join(void);
+
+   bool isStarted(void);
+
+   Thread(void);
+
+private:
+#ifdef WIN32
+   //windows threads return a DWORD, this calls the entry for them
+   static DWORD WINAPI trampoline(LPVOID);
+
+   HANDLE handle;
+   Entry entry;
+   void * arg;
+#else
+   pthread_t thread;
+#endif
+   bool started;
+};
+#endif
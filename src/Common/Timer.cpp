@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Millisecond clock and sleeps, see Timer.h
+ */
+#include "Timer.h"
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+long Timer::currentMillis(void)
+{
+#ifdef WIN32
+   return GetTickCount();
+#elif defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+   //doesn't jump when the wall clock is set, worked out in 64 bits as
+   //seconds * 1000 overflow a 32 bit long, only differences matter so
+   //it wrapping there is fine, same as GetTickCount
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (long) ((long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#else
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return (long) ((long long) tv.tv_sec * 1000 + tv.tv_usec / 1000);
+#endif
+}
+
+void Timer::sleepMillis(long ms)
+{
+   if(ms <= 0)
+      return;
+#ifdef WIN32
+   Sleep(ms);
+#else
+   struct timespec ts;
+   ts.tv_sec = ms / 1000;
+   ts.tv_nsec = (ms % 1000) * 1000000L;
+   nanosleep(&ts, NULL);
+#endif
+}
+
+void Timer::sleepRemaining(long start, long ms)
+{
+   sleepMillis(ms - (currentMillis() - start));
+}
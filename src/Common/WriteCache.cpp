@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Cache of the bin last written to each device, see WriteCache.h
+ */
+#include "WriteCache.h"
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include "Journal.h"
+#include "Thread.h"
+
+//held while a cache file is read or written, so two caches on different
+//threads pointed at the same file don't lose each others entries, the
+//file lock does the same for other processes, there's none on windows
+static Mutex cacheLock;
+
+bool WriteCache::setFile(std::string s)
+{
+   cacheFile = s;
+   entries.clear();
+   return enabled = true;
+}
+
+std::string WriteCache::getFile(void)
+{
+   return cacheFile;
+}
+
+bool WriteCache::setEnabled(bool b)
+{
+   enabled = b;
+   return true;
+}
+
+bool WriteCache::isEnabled(void)
+{
+   return enabled;
+}
+
+bool WriteCache::isCached(std::string device, std::string h)
+{
+   bool found = false;
+   int held;
+
+   if(!enabled)
+      return false;
+
+   cacheLock.lock();
+   held = lockFile();
+   load();
+   for(unsigned int i = 0; i < entries.size(); i++)
+      if(entries[i].device == device)
+      {
+         found = entries[i].hash == h;
+         break;
+      }
+   unlockFile(held);
+   cacheLock.unlock();
+
+   return found;
+}
+
+bool WriteCache::record(std::string device, std::string h)
+{
+   Entry e;
+   unsigned int i;
+   int held;
+   bool ok;
+
+   if(!enabled)
+      return false;
+
+   cacheLock.lock();
+   held = lockFile();
+   //A missing file is fine, it just hasn't been written yet
+   load();
+
+   for(i = 0; i < entries.size(); i++)
+      if(entries[i].device == device)
+         break;
+
+   if(i == entries.size())
+   {
+      e.device = device;
+      entries.push_back(e);
+   }
+   entries[i].hash = h;
+
+   ok = save();
+   unlockFile(held);
+   cacheLock.unlock();
+
+   return ok;
+}
+
+bool WriteCache::clear(std::string prefix)
+{
+   bool changed = false, ok = true;
+   int held;
+
+   if(!enabled)
+      return false;
+
+   cacheLock.lock();
+   held = lockFile();
+   load();
+   for(unsigned int i = 0; i < entries.size(); )
+   {
+      if(entries[i].device.compare(0, prefix.size(), prefix) == 0)
+      {
+         entries.erase(entries.begin() + i);
+         changed = true;
+      }
+      else
+         i++;
+   }
+
+   if(changed)
+      ok = save();
+   unlockFile(held);
+   cacheLock.unlock();
+
+   return ok;
+}
+
+//Only a cache kept in a file needs it, the same lock Journal takes
+int WriteCache::lockFile(void)
+{
+   return cacheFile.empty() ? -1 : Journal::lockFile(cacheFile);
+}
+
+void WriteCache::unlockFile(int held)
+{
+   Journal::unlockFile(held);
+}
+
+bool WriteCache::load(void)
+{
+   std::ifstream in;
+   std::string line;
+   Entry e;
+
+   if(cacheFile.empty())
+      return true;
+
+   entries.clear();
+   in.open(cacheFile.c_str());
+   if(!in.is_open())
+      return false;
+
+   while(std::getline(in, line))
+   {
+      std::istringstream fields(line);
+      if(fields >> e.device >> e.hash)
+         entries.push_back(e);
+   }
+   return true;
+}
+
+bool WriteCache::save(void)
+{
+   std::ofstream out;
+   std::string tmp = cacheFile + ".tmp";
+
+   if(cacheFile.empty())
+      return true;
+
+   out.open(tmp.c_str(), std::ios::out | std::ios::trunc);
+   if(!out.is_open())
+      return false;
+
+   for(unsigned int i = 0; i < entries.size(); i++)
+      out << entries[i].device << " " << entries[i].hash << std::endl;
+
+   out.close();
+   if(out.fail())
+      return false;
+
+   return rename(tmp.c_str(), cacheFile.c_str()) == 0;
+}
+
+WriteCache::WriteCache(void)
+{
+   enabled = false;
+}
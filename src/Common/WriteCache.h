@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Cache of the bin last written and verified to each device
+ *
+ * Each entry is a device and the hash of the bin that was last written
+ * to it and verified.  A write of the same bin can look itself up here
+ * and, if a quick spot check of the device agrees, skip the write.
+ * Entries are dropped as soon as a device starts being written, so a
+ * write that dies part way never looks cached.
+ *
+ * With a file set the cache lasts between runs, otherwise it's only
+ * kept for as long as the object is around.  Every cache in the process
+ * takes the same lock around the file, and a lock on a .lock file next
+ * to it the way Journal does, so objects on different threads or in
+ * other processes can share one.
+ *
+ */
+#include <config.h>
+#include <string>
+#include <vector>
+
+class WriteCache
+{
+
+public:
+   //keeps the cache in the file passed so it lasts between runs, an
+   //empty name keeps it in memory, either way turns the cache on
+   bool setFile(std::string);
+
+   //gets the file the cache is kept in
+   std::string getFile(void);
+
+   //turns the cache on or off, it starts off
+   bool setEnabled(bool);
+   bool isEnabled(void);
+
+   //returns true if the hash in the 2nd arg is the bin last written
+   //and verified to the device in the 1st
+   bool isCached(std::string, std::string);
+
+   //records the hash of the bin just verified on the device
+   bool record(std::string, std::string);
+
+   //drops the entries for every device whose name starts with the string
+   //passed, done before the device is written or erased
+   bool clear(std::string);
+
+   //Constructor
+   WriteCache(void);
+
+private:
+   struct Entry
+   {
+      std::string device;
+      std::string hash;
+   };
+
+   //reads the cache file into entries, does nothing without a file
+   bool load(void);
+
+   //writes entries out to the cache file through a temp file and a rename
+   bool save(void);
+
+   //takes and drops the lock on the cache file around a load and save,
+   //-1 if there's no file or lock
+   int lockFile(void);
+   void unlockFile(int);
+
+   std::string cacheFile;
+   bool enabled;
+   std::vector<Entry> entries;
+};
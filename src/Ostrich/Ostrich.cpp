@@ -30,6 +30,11 @@
  * in the Seraial.h/Serial.cpp file
  */
 #include "Ostrich.h"
+#include "Kernels.h"
+#include "StreamWriter.h"
+#include "Timer.h"
+#include "BufferPool.h"
+#include <stdio.h>
 
 bool Ostrich::updateChecksum(char c)
 {
@@ -44,6 +49,22 @@ bool Ostrich::updateChecksum(char c)
    return true;
 }
 
+//Adds a block to the checksum, summed a vector at a time
+bool Ostrich::updateChecksum(const char * src, int len)
+{
+   if(len <= 0)
+      return true;
+
+   if(checksumFirstByte)
+   {
+      checksum = 0;
+      checksumFirstByte = false;
+   }
+   checksum += Kernels::checksum(src, len);
+
+   return true;
+}
+
 
 //Starts checksum process over again, will not change last checksum
 bool Ostrich::resetChecksum(void)
@@ -65,59 +86,52 @@ bool Ostrich::resetBinIdx(void)
 }
 
 //This operates on currently set read/write bank
+//Only the extents the file has data for are read back and compared,
+//each block lands in the same buffer so nothing the size of the bank
+//is needed, and nothing below the bin's offset is read at all
 bool Ostrich::verifyBankToFile(void)
 {
-   char * fileOnDisk = NULL;
-   int fsize = 0;
+   int i = 0;
+   long done = 0;
+   bool ok = true;
+   char * block;
 
-   //Setup offset
-   if(!calculateOffset())
+   if(!readFileToMemory())
       return false;
 
-   //Read the chip into the bin array
-   if(!readBankToMemory())
+   //a block is never bigger than blockSize, plus one for the checksum
+   if((block = BufferPool::acquire(blockSize + 1)) == NULL)
       return false;
 
-   if(file.is_open())
-      file.close();
+   meter.start("verify", image.getDataLength(), retryCount);
 
-   file.open(binFileName.c_str() , std::ios::in | std::ios::ate | std::ios::binary);
-   //if there was an error opening it or the size is larger than the rom, bail
-   if( (!file.is_open() ) || file.tellg() > currentBankSize )
+   const std::vector<Extent> & extents = image.getExtents();
+   for(unsigned int e = 0; ok && e < extents.size(); e++)
    {
-      file.close();
-      return false;
-   }
-
-   //Get length of file
-   fsize = file.tellg();
-
-   //allocate some memory to hold file
-   fileOnDisk = new char[fsize];
-
-   //Go to beginning of file
-   file.seekg(0, std::ios::beg);
-
-   //Suck the file into memory
-   file.read(fileOnDisk, fsize);
-
-   //Walk the array based upon offsets and make sure that
-   //the bytes match up
-   for(int i = offset; i < currentBankSize ; i++)
-      if(fileOnDisk[i-offset] != bin[i] )
+      for(i = extents[e].start; ok && i < extents[e].end; i += lastBlockSize)
       {
-         delete[] fileOnDisk;
-         file.close();
-         return false;
+         transferEnd = blockEnd(i, extents[e].end);
+         ok = readBlock(i, block) &&
+              Kernels::isEqual(block, image.at(i), lastBlockSize);
+         done += lastBlockSize;
+         ok = ok && meter.update(done, i, retryCount);
       }
-   delete[] fileOnDisk;
-   file.close();
-   return true;
+   }
+   transferEnd = 0;
+   BufferPool::release(block);
+   return ok;
 }
 
+//If a journal is set, a write of the same bin to this bank that died
+//part way is picked up from the last block it recorded
+//Only the extents the bin has data for are sent, the gaps are left alone
 bool Ostrich::writeMemoryToBank(void)
 {
    int i = 0;
+   int start;
+   int attempt;
+   long done = 0;
+   std::string hash;
    //reset current chunk of bin to start and setup the offset
 
    if( !resetBinIdx())
@@ -137,50 +151,206 @@ bool Ostrich::writeMemoryToBank(void)
 
       return false;
    }
-   //Walk through bin sending chunks of the specified
-   //block size
-   for( i = offset; i < currentBankSize; i+=lastBlockSize)
+
+   //the bin has to have been loaded by readFileToMemory
+   if( image.isEmpty() || image.getEnd() > currentBankSize )
+      return false;
+
+   //a write that dies part way mustn't look cached
+   dropCached();
+
+   start = image.getStart();
+   if(journal.isEnabled())
    {
-      if(! buildCommand( 'W', i , 0))
-      {
-#ifdef DEBUG
-         std::cerr << "buildcommand failed" << std::endl;
-#endif
+      hash = image.hash();
+      start = resumeAddress(hash);
+   }
 
-         return false;
-      }
-      if(!sendCommands() )
-      {
+   meter.start("write", image.getDataLength(start, currentBankSize), retryCount);
 
-#ifdef DEBUG
-         std::cerr << "sendCommands failed" << std::endl;
-#endif
+   const std::vector<Extent> & extents = image.getExtents();
+   for(unsigned int e = 0; e < extents.size(); e++)
+   {
+      if(extents[e].end <= start)
+         continue;
 
-         return false;
-      }
-      if(!sendDataBlock())
+      //Walk through the extent sending chunks of the specified
+      //block size
+      for(i = extents[e].start > start ? extents[e].start : start; i < extents[e].end; i+=lastBlockSize)
       {
+         transferEnd = blockEnd(i, extents[e].end);
+         for(attempt = 0; !( buildCommand( 'W', i , 0) &&
+                             sendCommands() &&
+                             sendDataBlock(image.at(i)) ); attempt++)
+         {
 #ifdef DEBUG
-         std::cerr << "sendDataBlock failed" << std::endl;
+            std::cerr << "write of block at: " << i << " failed on attempt: " << attempt << std::endl;
 #endif
-
-         return false;
+            if(!retryBlock(attempt))
+            {
+               transferEnd = 0;
+               return false;
+            }
+         }
+         //blocks are big on the ostrich, so each one is recorded
+         if(journal.isEnabled())
+            journal.record(journalDevice(), hash, i + lastBlockSize);
+         done += lastBlockSize;
+         if(!meter.update(done, i, retryCount))
+         {
+            transferEnd = 0;
+            return false;
+         }
       }
    }
-   //Check to see if we wrote the whole thing out
-   if( i >= currentBankSize)
-      return true;
+   transferEnd = 0;
+   return true;
+}
+
+//Bulk blocks are addressed in 256 byte steps, so a block starting off a
+//boundary only goes up to the next one, and a run of bulk blocks stops
+//at the last boundary before the end, leaving the rest as a short block
+int Ostrich::blockEnd(int addr, int end)
+{
+   int aligned;
+
+   if(addr % bulkBlockSize)
+      aligned = addr - addr % bulkBlockSize + bulkBlockSize;
    else
+      aligned = end - end % bulkBlockSize;
+
+   return (aligned > addr && aligned < end) ? aligned : end;
+}
+
+//Looks the bin up in the journal, if an earlier write of it to this
+//bank stopped part way the block before where it stopped is read back
+//and checked, returns the address to carry on from or the start of the bin
+int Ostrich::resumeAddress(std::string hash)
+{
+   char tmp[bulkBlockSize+1];
+   int addr, check, saved, savedEnd;
+   bool ok;
+
+   addr = journal.getResumeAddress(journalDevice(), hash);
+   if(addr <= image.getStart() || addr > currentBankSize || !image.covers(addr - 1))
+      return image.getStart();
+
+   //spot check with a single small block, from no further down than
+   //the start of the extent it ends in
+   check = addr - bulkBlockSize < image.getStart() ? image.getStart() : addr - bulkBlockSize;
+   while(!image.covers(check))
+      check++;
+   //the block has to stop at addr, or it's sized from the end of the
+   //bank and asks for more than tmp holds
+   saved = blockSize;
+   savedEnd = transferEnd;
+   blockSize = addr - check;
+   transferEnd = addr;
+   ok = readBlock(check, tmp) &&
+        Kernels::isEqual(tmp, image.at(check), lastBlockSize < blockSize ? lastBlockSize : blockSize);
+   blockSize = saved;
+   transferEnd = savedEnd;
+
+   return ok ? addr : image.getStart();
+}
+
+//name this ostrich and bank go by in the journal, the serial
+//number keeps two units swapped between ports apart
+std::string Ostrich::journalDevice(void)
+{
+   char sn[serialNumberLen*2+1];
+
+   for(int i = 0; i < serialNumberLen; i++)
+      snprintf(sn + i*2, 3, "%02x", (unsigned char) serialNumber[i]);
+
+   return std::string("ostrich:") + comPort + ":" + sn + ":" + (char) ('0' + updateBank);
+}
+
+//Samples are spread evenly over the data in the bin, kept to a bulk
+//block and to bulk boundaries so they can be read like any other block
+bool Ostrich::spotCheck(void)
+{
+   char tmp[bulkBlockSize+1];
+   Extent r;
+   int saved = blockSize;
+   bool ok = true;
+
+   for(int i = 0; ok && i < cacheSamples; i++)
+   {
+      if(!image.sample(i, cacheSamples, bulkBlockSize, r))
+         break;
+
+      transferEnd = blockEnd(r.start, r.end);
+      blockSize = transferEnd - r.start;
+      ok = readBlock(r.start, tmp) &&
+           Kernels::isEqual(tmp, image.at(r.start), blockSize);
+   }
+   transferEnd = 0;
+   blockSize = saved;
+   return ok;
+}
+
+//The whole device overlaps every bank, so writing it drops them all
+//and writing a bank drops the whole device
+void Ostrich::dropCached(void)
+{
+   std::string dev = journalDevice();
+   std::string port = dev.substr(0, dev.size() - 1);
+
+   if(updateBank == wholeEnchilada)
+      cache.clear(port);
+   else
+   {
+      cache.clear(dev);
+      cache.clear(port + (char) ('0' + wholeEnchilada));
+   }
+}
+
+//reads the block at the address passed into dest, without touching bin
+bool Ostrich::readBlock(int addr, char * dest)
+{
+   for(int attempt = 0; ; attempt++)
+   {
+      if( buildCommand('R', addr, 0) &&
+            serial.purgeRX() &&
+            sendCommands() &&
+            getDataBlock(dest) )
+         return true;
+
+      if(!retryBlock(attempt))
+         return false;
+   }
+}
+
+//Called after a block fails, returns false once it's out of retries
+//otherwise waits, doubling the wait each time, and clears out anything
+//left in the port from the failed attempt so the block can be tried again
+bool Ostrich::retryBlock(int attempt)
+{
+   if(attempt >= maxRetries)
       return false;
 
+   if(attempt == 0)
+      blocksRetried++;
+   retryCount++;
+
+   Timer::sleepMillis((long) retryDelay << attempt);
+   serial.purgeRX();
+   return true;
 }
 
 bool Ostrich::readBankToMemory(void)
 {
    int i = 0;
+   int attempt;
+
+   //the last block's checksum lands past the end of the bank
+   if(!reserveBin(currentBankSize + 1))
+      return false;
 
    //reset the index so reads will start at 0
    resetBinIdx();
+   meter.start("read", currentBankSize, retryCount);
    //loop counter is used as address counter too
 
    for( i = 0; i < currentBankSize ; i+=blockSize)
@@ -188,35 +358,21 @@ bool Ostrich::readBankToMemory(void)
 #ifdef DEBUG
       std::cerr << "in getbank loop for i=" << i << std::endl;
 #endif
-      if(! buildCommand( 'R', i, 0) )
-      {
-#ifdef DEBUG
-         std::cerr << "buildCommand failed" << std::endl;
-#endif
-         return false;
-      }
-      if(! serial.purgeRX() )
-      {
-#ifdef DEBUG
-         std::cerr << "purgeRX failed" << std::endl;
-#endif
-         return false;
-      }
-      if(! sendCommands() )
+      //getDataBlock leaves binIdx alone on a failure so
+      //the same block is just asked for again
+      for(attempt = 0; !( buildCommand( 'R', i, 0) &&
+                          serial.purgeRX() &&
+                          sendCommands() &&
+                          getDataBlock() ); attempt++)
       {
 #ifdef DEBUG
-         std::cerr << "sendCommands failed" << std::endl;
+         std::cerr << "read of block at: " << i << " failed on attempt: " << attempt << std::endl;
 #endif
-         return false;
+         if(!retryBlock(attempt))
+            return false;
       }
-
-      if(! getDataBlock() )
-      {
-#ifdef DEBUG
-         std::cerr << "getdatablock failed" << std::endl;
-#endif
+      if(!meter.update(i + blockSize < currentBankSize ? i + blockSize : currentBankSize, i, retryCount))
          return false;
-      }
    }
 
    //Check to see if we read the whole bin
@@ -226,6 +382,34 @@ bool Ostrich::readBankToMemory(void)
       return false;
 }
 
+//Streams the bank to the bin file, "-" for stdout, the writer thread
+//saves each block while the next one is read, so output starts straight
+//away and only a few blocks are ever held, a file that doesn't get the
+//whole bank is removed
+bool Ostrich::readBankToFile(void)
+{
+   StreamWriter out;
+   char * slot;
+   int i;
+
+   if(!out.open(binFileName, blockSize))
+      return false;
+
+   meter.start("read", currentBankSize, retryCount);
+   for(i = 0; i < currentBankSize; i += lastBlockSize)
+   {
+      if((slot = out.getSlot()) == NULL ||
+            !readBlock(i, slot) ||
+            !out.commit(lastBlockSize) ||
+            !meter.update(i + lastBlockSize, i, retryCount))
+      {
+         out.abort();
+         return false;
+      }
+   }
+   return out.close();
+}
+
 bool Ostrich::writeMemoryToFile(void)
 {
    bool b;
@@ -234,31 +418,18 @@ bool Ostrich::writeMemoryToFile(void)
 
    file.open(binFileName.c_str(), std::ios::out | std::ios::binary);
    //if there was an error opening the file, bail
-   if( !file.is_open() )
+   if( !file.is_open() || bin == NULL || binSize < currentBankSize )
       return false;
    b =  file.write(bin, currentBankSize);
    file.close();
    return b;
 }
 
+//HEX and S-records say where they go in the bank, raw bins go at
+//the top of it by their size
 bool Ostrich::readFileToMemory(void)
 {
-   int fsize = 0;
-   bool b;
-   if(file.is_open())
-      file.close();
-
-   file.open(binFileName.c_str() , std::ios::in | std::ios::ate | std::ios::binary);
-   //if there was an error opening it or the size is larger than the rom, bail
-   if( (!file.is_open() ) || file.tellg() > currentBankSize )
-      return false;
-   fsize = file.tellg();
-
-   //go back to beginning
-   file.seekg(0);
-   b =  file.read(bin, fsize);
-   file.close();
-   return b;
+   return image.load(binFileName, currentBankSize);
 }
 // this will write a file to a bank
 // using an automatic offset based upon
@@ -269,13 +440,27 @@ bool Ostrich::readFileToMemory(void)
 //
 bool Ostrich::writeFileToBank(void)
 {
-   return ( checkForDevice() &&
-            calculateOffset() &&
-            readFileToMemory() &&
-            writeMemoryToBank() &&
-            verifyBankToFile() ) ;
-}
+   writeSkipped = false;
+   if( !checkForDevice() ||
+         !readFileToMemory() ||
+         !calculateOffset() )
+      return false;
+
+   //Already in the bank, a spot check is enough
+   if(cache.isCached(journalDevice(), image.hash()) && spotCheck())
+      return writeSkipped = true;
 
+   if( writeMemoryToBank() &&
+         verifyBankToFile() )
+   {
+      //It's all on there and checked, nothing left to pick up
+      if(journal.isEnabled())
+         journal.clear(journalDevice());
+      cache.record(journalDevice(), image.hash());
+      return true;
+   }
+   return false;
+}
 //This will set the update bank on the hardware based upon passed bank number
 //and character, 'U' for read/write, 'P' for persistent, 'E' for emulation
 //Needs to handle switch between banked and full device mode gracefully
@@ -530,28 +715,20 @@ int Ostrich::getBank(char c)
 //
 bool Ostrich::calculateOffset(void)
 {
-   int tmp;
-   if(file.is_open())
-      file.close();
+   //the loaded image already knows, without opening the file again
+   int tmp = image.isLoaded(binFileName, currentBankSize, 0) ?
+             image.getPlace() : Image::place(binFileName, currentBankSize);
 
-   file.open(binFileName.c_str() , std::ios::in | std::ios::ate | std::ios::binary);
-   if(!file.is_open())
+   if(tmp < 0)
       return false;
-
-   tmp = currentBankSize - file.tellg();
-   if(tmp >= 0)
-   {
-      if(tmp < currentBankSize)
-         offset = tmp;
-
-      else
-         offset = 0;
-      file.close();
-      return true;
-   }
-   file.close();
-   return	false;
+   offset = tmp;
+   return true;
+}
+std::vector<Extent> Ostrich::getExtents(void)
+{
+   return image.getExtents();
 }
+
 int Ostrich::getOffset(void)
 {
    return offset;
@@ -600,6 +777,149 @@ std::string Ostrich::getComPort(void)
    return comPort;
 }
 
+bool Ostrich::setRetries(int i)
+{
+   if(i < 0)
+      return false;
+
+   maxRetries = i;
+   return true;
+}
+
+int Ostrich::getRetries(void)
+{
+   return maxRetries;
+}
+
+bool Ostrich::setRetryDelay(int i)
+{
+   if(i < 0)
+      return false;
+
+   retryDelay = i;
+   return true;
+}
+
+int Ostrich::getRetryDelay(void)
+{
+   return retryDelay;
+}
+
+int Ostrich::getRetryCount(void)
+{
+   return retryCount;
+}
+
+int Ostrich::getBlocksRetried(void)
+{
+   return blocksRetried;
+}
+
+bool Ostrich::resetRetryStats(void)
+{
+   retryCount = blocksRetried = 0;
+   return true;
+}
+
+bool Ostrich::setJournalFile(std::string s)
+{
+   return journal.setFile(s);
+}
+
+std::string Ostrich::getJournalFile(void)
+{
+   return journal.getFile();
+}
+
+bool Ostrich::setCacheFile(std::string s)
+{
+   cache.setFile(s);
+   return cache.setEnabled(!s.empty());
+}
+
+std::string Ostrich::getCacheFile(void)
+{
+   return cache.getFile();
+}
+
+bool Ostrich::getWriteSkipped(void)
+{
+   return writeSkipped;
+}
+
+bool Ostrich::setProgressObserver(ProgressObserver * o)
+{
+   return meter.setObserver(o);
+}
+
+ProgressObserver * Ostrich::getProgressObserver(void)
+{
+   return meter.getObserver();
+}
+
+const std::vector<PhaseTime> & Ostrich::getPhaseTimes(void)
+{
+   return meter.getPhases();
+}
+
+bool Ostrich::clearPhaseTimes(void)
+{
+   return meter.clearPhases();
+}
+
+long Ostrich::getBytesSent(void)
+{
+   return serial.getBytesSent();
+}
+
+long Ostrich::getBytesReceived(void)
+{
+   return serial.getBytesReceived();
+}
+
+bool Ostrich::runAsync(int op)
+{
+   switch(op)
+   {
+   case OSTRICH_WRITE:
+      return writeFileToBank();
+   case OSTRICH_READ:
+      return readBankToFile();
+   case OSTRICH_VERIFY:
+      return verifyBankToFile();
+   case OSTRICH_TRACE_TO_BUF:
+      return getTraceToBuf();
+   case OSTRICH_TRACE_TO_MAP:
+      return getTraceToMap();
+   case OSTRICH_TRACE_TO_BUF_MAP:
+      return getTraceToBufMap();
+   case OSTRICH_TRACE_TO_FILE:
+      return getTraceToFile();
+   default:
+      return false;
+   }
+}
+
+bool Ostrich::cancel(void)
+{
+   return meter.cancel();
+}
+
+bool Ostrich::setDeadline(long ms)
+{
+   return meter.setDeadline(ms);
+}
+
+bool Ostrich::clearDeadline(void)
+{
+   return meter.clearDeadline();
+}
+
+bool Ostrich::wasStopped(void)
+{
+   return meter.wasStopped();
+}
+
 bool Ostrich::sendCommands(void)
 {
    int i, len;
@@ -897,18 +1217,55 @@ bool Ostrich::setTraceBuf(int * ip, int i)
 }
 bool Ostrich::wasHit(int i)
 {
-   if( hitMap[i] )
+   if( hitMap != NULL && i >= 0 && i < maxBinSize && hitMap[i] )
       return true;
 
    return false;
 }
 
+//Nothing's been hit if the map hasn't been made yet
 bool Ostrich::resetHitMap(void)
 {
+   if(hitMap != NULL)
+      memset( (void *) hitMap, 0, maxBinSize);
+   return true;
+}
+
+//The map is only needed once traces go to it, it comes from
+//the pool cleared
+bool Ostrich::reserveHitMap(void)
+{
+   if(hitMap != NULL)
+      return true;
+
+   if((hitMap = BufferPool::acquire(maxBinSize)) == NULL)
+      return false;
+
    memset( (void *) hitMap, 0, maxBinSize);
    return true;
 }
 
+//Makes sure bin has room for the number of bytes passed, if it doesn't a
+//bigger one comes from the pool with the old contents copied over
+bool Ostrich::reserveBin(int size)
+{
+   char * tmp;
+
+   if(bin != NULL && binSize >= size)
+      return true;
+
+   if((tmp = BufferPool::acquire(size)) == NULL)
+      return false;
+
+   if(bin != NULL)
+      memcpy(tmp, bin, binSize);
+
+   BufferPool::release(bin);
+   bin = tmp;
+   binSize = size;
+   return true;
+}
+
 bool Ostrich::resetHitIdx(void)
 {
    hitIdx = 0;
@@ -920,6 +1277,9 @@ int Ostrich::getNextAddressHit(void)
 {
    int hitAddr = 0;
 
+   if(hitBuffer == NULL)
+      return -1;
+
    if(hitBuffer[hitIdx] == dataOK && hitIdx == (traceAddressBytes * addressesPerPacket * packetsPerTrace)+2 )
       return EOF;
 
@@ -963,6 +1323,7 @@ bool Ostrich::getTraceToBufMap(void)
    int tmp = 0;
    if(	extTraceBuffer &&
          serial.isOpen() &&
+         reserveHitMap() &&
          buildCommand(traceCommand, 0, 0) &&
          sendCommands() &&
          getTraceBlock() &&
@@ -1048,6 +1409,7 @@ bool Ostrich::getTraceToMap(void)
 {
    int tmp = !EOF;
    if( 	serial.isOpen() &&
+         reserveHitMap() &&
          buildCommand(traceCommand, 0, 0) &&
          sendCommands() &&
          getTraceBlock() &&
@@ -1141,7 +1503,7 @@ bool Ostrich::getHitMap(char * cp, int start, int end)
       return false;
 
    for(int i=0; i < end-start; i++)
-      cp[i] = hitMap[start+i];
+      cp[i] = hitMap != NULL ? hitMap[start+i] : 0;
 
    return true;
 }
@@ -1153,7 +1515,6 @@ bool Ostrich::getHitMap(char * cp, int start, int end)
 bool Ostrich::getDataBlock(void)
 {
    int sz = 0;
-   char tmp = 0;
 
    //if lastblocsize is set smaller than the
    //normal blocksize, we need short read/write
@@ -1162,61 +1523,70 @@ bool Ostrich::getDataBlock(void)
    else
       sz = blockSize;
 
-   if( binIdx + sz <= currentBankSize)
+   if( bin == NULL || binIdx + sz + 1 > binSize)
    {
-      if(!serial.getBytes( bin+binIdx, sz))
-      {
 #ifdef DEBUG
-         std::cerr << "getBytes failed in getDataBlock size: "<< sz << std::endl;
-#endif
-         return false;
-      }
-      if(!serial.getByte(&tmp))
-      {
-#ifdef DEBUG
-         std::cerr << "read failed to return checksum" << std::endl;
+      std::cerr << "getBytes failed because of overflow in bin array size of read block: " << sz << std::endl;
 #endif
-         return false;
-      }
+
 #ifdef DEBUG
-      std::cerr << "getBytes read back: " << sz << " bytes." << std::endl;
+      std::cerr << "getBytes failed because of overflow in bin array current index: " << binIdx << std::endl;
 #endif
 
+      return false;
+   }
+
+   if(getDataBlock(bin+binIdx))
+   {
+      binIdx+=sz;
+      return true;
    }
+   //If something went wrong, leave the bin index alone and return a failue
+   return false;
+}
+
+//reads the block into the buffer passed instead of bin
+bool Ostrich::getDataBlock(char * dest)
+{
+   int sz = 0;
+   char tmp = 0;
+
+   //if lastblocsize is set smaller than the
+   //normal blocksize, we need short read/write
+   if(lastBlockSize < blockSize)
+      sz = lastBlockSize;
    else
+      sz = blockSize;
+
+   if(!serial.getBytes( dest, sz))
    {
 #ifdef DEBUG
-      std::cerr << "getBytes failed because of overflow in bin array size of read block: " << sz << std::endl;
+      std::cerr << "getBytes failed in getDataBlock size: "<< sz << std::endl;
 #endif
-
+      return false;
+   }
+   if(!serial.getByte(&tmp))
+   {
 #ifdef DEBUG
-      std::cerr << "getBytes failed because of overflow in bin array current index: " << binIdx << std::endl;
+      std::cerr << "read failed to return checksum" << std::endl;
 #endif
-
       return false;
    }
+#ifdef DEBUG
+   std::cerr << "getBytes read back: " << sz << " bytes." << std::endl;
+#endif
+
 #ifdef DEBUG
    std::cerr << "getBytes about to verify checksum sz is : " << sz << std::endl;
 #endif
 
    //reset the checksum and check it
-   if( !resetChecksum())
+   if( !resetChecksum() || !updateChecksum(dest, sz))
       return false;
 
-   for(int i=0; i<sz && binIdx+i<currentBankSize; i++)
-   {
-#ifdef DEBUG
-      std::cerr << "checksumming byte " << binIdx+i << std::endl;
-#endif
-
-      updateChecksum(bin[binIdx+i]);
-   }
    if(tmp==getChecksum())
-   {
-      binIdx+=sz;
       return true;
-   }
-   //If something went wrong, Reset the bin index and return a failue
+
 #ifdef DEBUG
    std::cerr << "Checksum verification on getDataBlock failed returned sum is: " << (int) tmp;
    std::cerr << " computed sum is: " << (int) getChecksum() << std::endl;
@@ -1231,6 +1601,10 @@ bool Ostrich::getTraceBlock(void)
 
    sz = (traceAddressBytes * addressesPerPacket * packetsPerTrace) + 2;
 
+   //only made the first time a trace is read
+   if(hitBuffer == NULL && (hitBuffer = BufferPool::acquire(hitBufferMaxSize)) == NULL)
+      return false;
+
    if(sz <= hitBufferMaxSize && serial.getBytes(hitBuffer, sz))
       if(hitBuffer[0] == dataOK && hitBuffer[sz-1] == dataOK)
          return true;
@@ -1245,7 +1619,6 @@ bool Ostrich::getTraceBlock(void)
 bool Ostrich::sendDataBlock(void)
 {
    int sz;
-   char tmp;
 
    //if lastblocsize is set smaller than the
    //normal blocksize, we need short read/write
@@ -1254,27 +1627,16 @@ bool Ostrich::sendDataBlock(void)
    else
       sz = blockSize;
 
+   //nothing's been loaded to send there, bin[] only holds what's read back
+   if( image.isEmpty() || offset + binIdx < image.getStart() ||
+       offset + binIdx + sz > image.getEnd())
+      return false;
+
 #ifdef DEBUG
    std::cerr << "sendng data to index: "<<std::hex << binIdx+offset << " of count: " << sz << std::endl;
 #endif
 
-   for(int i = 0; i < sz ; i++)
-      updateChecksum(bin[binIdx+i]);
-
-   tmp = getChecksum();
-
-   //purge the receive buffers so we don't get a false return on
-   //the dataOK check byte
-   if(! serial.purgeRX() )
-      return false;
-
-   //attempt to send the data, checksum
-   //retrieve the acknowledgement and verify it;
-   if( 	serial.sendBytes(bin+binIdx, sz) &&
-         serial.sendByte(&tmp) &&
-         serial.getByte(&tmp) &&
-         tmp == dataOK
-     )
+   if(sendDataBlock(image.at(offset + binIdx)))
    {
       binIdx+=sz;
       return true;
@@ -1287,6 +1649,32 @@ bool Ostrich::sendDataBlock(void)
 
 }
 
+bool Ostrich::sendDataBlock(const char * src)
+{
+   int sz;
+   char tmp;
+
+   if( lastBlockSize < blockSize)
+      sz = lastBlockSize;
+   else
+      sz = blockSize;
+
+   updateChecksum(src, sz);
+   tmp = getChecksum();
+
+   //purge the receive buffers so we don't get a false return on
+   //the dataOK check byte
+   if(! serial.purgeRX() )
+      return false;
+
+   //attempt to send the data, checksum
+   //retrieve the acknowledgement and verify it;
+   return ( serial.sendBytes(src, sz) &&
+            serial.sendByte(&tmp) &&
+            serial.getByte(&tmp) &&
+            tmp == dataOK );
+}
+
 /* this function builds the command to send to the
  * ostrich, all requests in case of reads and writes
  * are setup to calc the lastblocsize variable that is
@@ -1298,7 +1686,7 @@ bool Ostrich::buildCommand(int cmd , int addr, int bank)
 {
    int cmdIdx=0;
    int sz = 0;
-   int leftToWrite = currentBankSize - addr;
+   int leftToWrite = (transferEnd > 0 ? transferEnd : currentBankSize) - addr;
 #ifdef DEBUG
    std::cerr << "buildCommand got: ";
    std::cerr << (char) cmd << " " << (char) addr << " " << (char) bank ;
@@ -1619,7 +2007,13 @@ Ostrich::Ostrich()
 
    extTraceBuffer = NULL;
    addressesPerPacket = packetsPerTrace = extTraceBufferSize = 0;
-   currentBankSize = 0;
+   currentBankSize = transferEnd = 0;
+   bin = hitMap = hitBuffer = NULL;
+   binSize = 0;
+   maxRetries = defaultRetries;
+   retryDelay = defaultRetryDelay;
+   retryCount = blocksRetried = 0;
+   writeSkipped = false;
    serial.setTimeouts(1000,0,0,0,0);
    serial.applySettings();
 }
@@ -1630,4 +2024,8 @@ Ostrich::~Ostrich()
 
    if(file.is_open())
       file.close();
+
+   BufferPool::release(bin);
+   BufferPool::release(hitMap);
+   BufferPool::release(hitBuffer);
 }
@@ -46,8 +46,26 @@
 #include <iostream>
 #include <fstream>
 #include "Serial.h"
+#include "Journal.h"
+#include "WriteCache.h"
+#include "Image.h"
+#include "Progress.h"
+#include "AsyncOp.h"
+
+//The ops an AsyncOp can run on an Ostrich, reads go to the bin file and
+//traces go wherever the matching getTraceTo function puts them
+enum OstrichOp
+{
+   OSTRICH_WRITE,
+   OSTRICH_READ,
+   OSTRICH_VERIFY,
+   OSTRICH_TRACE_TO_BUF,
+   OSTRICH_TRACE_TO_MAP,
+   OSTRICH_TRACE_TO_BUF_MAP,
+   OSTRICH_TRACE_TO_FILE
+};
 
-class Ostrich
+class Ostrich : public AsyncTarget
 {
 
 
@@ -61,6 +79,9 @@ public:
    //Calcuates a running checksum, returning it each time
    bool updateChecksum(char);
 
+   //adds a whole block to the running checksum
+   bool updateChecksum(const char *, int);
+
    //resets checksum so that it starts fresh upon next call
    bool resetChecksum(void);
 
@@ -79,14 +100,24 @@ public:
    //function to write memory buffer to file
    bool writeMemoryToFile(void);
 
+   //streams the bank straight to the bin file, "-" for stdout, a block at
+   //a time without holding the whole thing, see StreamWriter.h
+   bool readBankToFile(void);
+
    //function to load the data from the memory buffer to disk
+   //Intel HEX and S-record files are loaded at the addresses they give
+   //in the bank and only the ranges they cover are written, raw bins by their size
    bool readFileToMemory(void);
 
+   //returns the address ranges of the bank the last file loaded had data for
+   std::vector<Extent> getExtents(void);
+
    //function to write file to chip and verify it
    //This does the erase, verify of erase, burn and verify in one shot
    bool writeFileToBank(void);
 
-   //Write to a bank
+   //Write to a bank, with a journal set picks up a write of the
+   //same bin that died part way
    bool writeMemoryToBank(void);
 
    //This will force the device to set all it's banks to the same setting
@@ -133,6 +164,77 @@ public:
    //gets current com port
    std::string getComPort(void);
 
+   //sets how many more times a block is tried after it fails before
+   //the whole read/write gives up, only the failed block is sent again
+   bool setRetries(int);
+
+   //gets the number of retries per block
+   int getRetries(void);
+
+   //sets the wait in ms before the first retry of a block, it doubles
+   //for each retry after that
+   bool setRetryDelay(int);
+
+   //gets the wait before the first retry
+   int getRetryDelay(void);
+
+   //returns the number of retries done since the stats were last reset
+   int getRetryCount(void);
+
+   //returns the number of blocks that needed at least one retry
+   int getBlocksRetried(void);
+
+   //clears the retry stats
+   bool resetRetryStats(void);
+
+   //sets the journal file writes record their progress in, so a write that
+   //dies part way can be picked up from where it stopped, empty turns it off
+   bool setJournalFile(std::string);
+
+   //gets the journal file
+   std::string getJournalFile(void);
+
+   //sets the file the hash of the bin last written and verified to each
+   //bank is kept in, writing the same bin there again is then only spot
+   //checked, empty turns it off
+   bool setCacheFile(std::string);
+   std::string getCacheFile(void);
+
+   //true if the last writeFileToBank found the bin already in the bank
+   bool getWriteSkipped(void);
+
+   //the observer is told how writes, reads and verifies are going after
+   //every block, NULL turns it off, it isn't deleted
+   bool setProgressObserver(ProgressObserver *);
+   ProgressObserver * getProgressObserver(void);
+
+   //how long each write, verify and read took, in the order they ran,
+   //kept until cleared
+   const std::vector<PhaseTime> & getPhaseTimes(void);
+   bool clearPhaseTimes(void);
+
+   //bytes sent to and read back from the hardware since the port was opened
+   long getBytesSent(void);
+   long getBytesReceived(void);
+
+   //runs one of the OstrichOps for an AsyncOp, see AsyncOp.h
+   bool runAsync(int);
+
+   //stops the write, read or verify going on at the next block, from any
+   //thread, it stays stopped until setDeadline, a trace is a single block
+   //so it always runs to the end
+   bool cancel(void);
+
+   //gives up on transfers at the next block once the ms passed have gone
+   //by, 0 for no deadline, clears any earlier cancel
+   bool setDeadline(long);
+
+   //drops the deadline once an op is over, wasStopped still answers for it
+   bool clearDeadline(void);
+
+   //true if the last failure was down to a cancel or the deadline
+   bool wasStopped(void);
+
    //Sends commands to device
    bool sendCommands(void);
 
@@ -156,14 +258,18 @@ public:
    // starting at previously set binIndex
    bool getDataBlock(void);
 
+   //reads a block of data from the serial port into the buffer passed
+   //doesn't touch bin[] or binIdx
+   bool getDataBlock(char *);
+
    //reads a block of trace data into the internal buffer
    //size is based upon the currently configured address length
    //addresses per packet and packets per trace
    bool getTraceBlock(void);
 
    //sends a block of data out the serial port
-   // size will match blockSize and data will from bin[]
-   // starting at previously set binIndex
+   // size will match blockSize and data will be from the loaded file
+   // at offset plus the previously set binIndex
    bool sendDataBlock(void);
 
    //builds the command
@@ -317,6 +423,44 @@ public:
    ~Ostrich();
 
 private:
+   //not copyable, the buffers from the pool would be handed back twice
+   Ostrich(const Ostrich &);
+   Ostrich & operator=(const Ostrich &);
+
+   //returns the address a journaled write of the bin with the hash passed
+   //can carry on from after spot checking it, or the offset if there isn't one
+   int resumeAddress(std::string);
+
+   //returns the name for this device and update bank in the journal and cache
+   std::string journalDevice(void);
+
+   //reads a few blocks spread over the bin and compares them, used to
+   //make sure the bank still holds a cached bin
+   bool spotCheck(void);
+
+   //drops the cache entries a write to the update bank makes stale
+   void dropCached(void);
+
+   //reads the block at the address passed into the buffer passed
+   bool readBlock(int, char *);
+
+   //sends a block of data from the buffer passed, doesn't touch bin[] or binIdx
+   bool sendDataBlock(const char *);
+
+   //returns where a block at the 1st address has to stop so bulk blocks
+   //start on a bulk boundary, no further than the 2nd address
+   int blockEnd(int, int);
+
+   //makes sure bin can hold the number of bytes passed
+   bool reserveBin(int);
+
+   //makes the hit map if it hasn't been yet
+   bool reserveHitMap(void);
+
+   //called with the attempt number after a block fails, waits and clears
+   //the port, returns false once the block is out of retries
+   bool retryBlock(int);
+
    //Largest bin we handle matches full address space of Ostrich
    static const int maxBinSize = 524288;
 
@@ -359,6 +503,13 @@ private:
    //character that device sends to OK data reception
    static const int dataOK = 'O';
 
+   //retries per block and ms before the first one, unless set otherwise
+   static const int defaultRetries = 3;
+   static const int defaultRetryDelay = 10;
+
+   //how many blocks a spot check of a cached bin reads
+   static const int cacheSamples = 8;
+
    //index in command string for writes
    static const int writeIdx = 0;
 
@@ -433,21 +584,38 @@ private:
    std::string comPort;
 
    Serial serial;
+   Journal journal;
+   WriteCache cache;
+   bool writeSkipped;
+   ProgressMeter meter;
    int offset;
+   int maxRetries;
+   int retryDelay;
+   int retryCount;
+   int blocksRetried;
    //Blocksize will be used to determine if bulk command should be used
    //or normal commands
    int blockSize;
    int lastBlockSize;
    int binIdx;
-   char bin[maxBinSize];
+   //sized to the bank when it's first needed, from BufferPool, with
+   //one extra byte so a block at the end of the bank has room for its checksum
+   char * bin;
+   int binSize;
+   //reads/writes are clamped so they don't run past this address,
+   //0 is the end of the bank
+   int transferEnd;
+   //the bin loaded by readFileToMemory
+   Image image;
    int command[maxCommandLen];
 
    //The hitMap could be implemented as bitmap if space starts to really be
-   //a problem, currently 1 char per address
-   char hitMap[maxBinSize];
+   //a problem, currently 1 char per address, made on the first trace to it
+   char * hitMap;
 
    // size the buffer for the readback of traces so it handles largest possible read and 2 oks
-   char hitBuffer[hitBufferMaxSize];
+   // made on the first trace
+   char * hitBuffer;
    //index for reading addresses back out of hit buffer
    int hitIdx;
 
@@ -33,6 +33,22 @@ bool Serial::isOpen(void)
    return portIsOpen;
 }
 
+long Serial::getBytesSent(void)
+{
+   return sentCount;
+}
+
+long Serial::getBytesReceived(void)
+{
+   return receivedCount;
+}
+
+bool Serial::resetByteCounts(void)
+{
+   sentCount = receivedCount = 0;
+   return true;
+}
+
 bool Serial::setSpeedAndDataBits(int speed, int dbits, int parity, int stop)
 {
    baudRate = speed;
@@ -128,12 +144,15 @@ bool Serial::sendByte(char * buf)
       bytesWritten = write( fd, buf, 1);
 
    if( bytesWritten == 1)
+   {
+      sentCount++;
       return true;
+   }
 
    return false;
 }
 
-bool Serial::sendBytes(char * buf, int count)
+bool Serial::sendBytes(const char * buf, int count)
 {
    bytesWritten = 0;
 
@@ -141,13 +160,14 @@ bool Serial::sendBytes(char * buf, int count)
    {
       bytesWritten = write( fd, buf, count);
 
-      if(bytesWritten == count)
-         return true;
-
-      bytesWritten += write(fd, buf+bytesWritten, count-bytesWritten);
+      if(bytesWritten != count)
+         bytesWritten += write(fd, buf+bytesWritten, count-bytesWritten);
 
       if( bytesWritten == count)
+      {
+         sentCount += count;
          return true;
+      }
    }
    return false;
 }
@@ -160,7 +180,10 @@ bool Serial::getByte(char * buf)
       bytesRead = read( fd, buf, 1);
 
    if( bytesRead == 1)
+   {
+      receivedCount++;
       return true;
+   }
 
    return false;
 }
@@ -181,7 +204,10 @@ bool Serial::getBytes(char * buf, int count)
          bytesRead += tmp;
       }
       if(bytesRead == count)
+      {
+         receivedCount += count;
          return true;
+      }
    }
 
    return false;
@@ -307,6 +333,8 @@ Serial::Serial(void)
 {
    termio = (termios *)malloc(sizeof(struct termios) );
    fd = 0;
+   portIsOpen = false;
+   sentCount = receivedCount = 0;
 
    readIntervalTimeout = 1;
    readTotalTimeoutMultiplier = 0;
@@ -56,7 +56,7 @@ public:
    bool purgeRX(void);
    bool purgeTX(void);
    bool sendByte(char *);
-   bool sendBytes(char *, int);
+   bool sendBytes(const char *, int);
    bool getByte(char *);
    bool getBytes(char *, int);
    bool applySettings(void);
@@ -65,6 +65,10 @@ public:
    bool setTXBufferSize(int);
    int getTXBufferSize(void);
    bool isOpen();
+   //bytes sent and received since the counts were last reset
+   long getBytesSent(void);
+   long getBytesReceived(void);
+   bool resetByteCounts(void);
    Serial(void);
    ~Serial(void);
 
@@ -85,6 +89,8 @@ private:
    //*nix specific stuff here
    size_t bytesRead;
    size_t bytesWritten;
+   long sentCount;
+   long receivedCount;
    struct termios * termio;
    int fd;
 };
@@ -33,6 +33,22 @@
 
 #include "Serial.h"
 
+long Serial::getBytesSent(void)
+{
+	return sentCount;
+}
+
+long Serial::getBytesReceived(void)
+{
+	return receivedCount;
+}
+
+bool Serial::resetByteCounts(void)
+{
+	sentCount = receivedCount = 0;
+	return true;
+}
+
 bool Serial::setSpeedAndDataBits(int baud, int data, int parity, int stop)
 {
 	baudRate = baud;
@@ -110,6 +126,7 @@ bool Serial::sendByte(char * cp)
 	if(portIsOpen)
 	{
 		WriteFile(commHandle, cp , 1, &bytesWritten, overlap) ;
+		sentCount += bytesWritten;
 		return (bytesWritten == 1);
 	}
 	return false;
@@ -125,12 +142,12 @@ bool Serial::sendBytes(char * cp, int num )
 	return false;
 }
 */
-bool Serial::sendBytes(char * cp, int num )
+bool Serial::sendBytes(const char * cp, int num )
 {
-	int tmp = 0;
 	if(portIsOpen)
 	{
 		WriteFile(commHandle, cp, num, &bytesWritten, overlap);
+		sentCount += bytesWritten;
 		return (bytesWritten == num);
 	}
 	return false;
@@ -140,6 +157,7 @@ bool Serial::getByte(char * cp)
 	if(portIsOpen)
 	{
 		ReadFile(commHandle, cp, 1, &bytesRead, overlap) ; 
+		receivedCount += bytesRead;
 		return (bytesRead == 1);
 	}
 	return false;
@@ -254,6 +272,7 @@ Serial::Serial()
 	dcb = NULL;
 	timeouts = NULL;
 	overlap = NULL;
+	sentCount = receivedCount = 0;
 
 	readIntervalTimeout = 0 ;
 	readTotalTimeoutMultiplier = 0;
@@ -47,7 +47,7 @@ public:
 	bool purgeRX(void);
 	bool purgeTX(void);
 	bool sendByte(char *);
-	bool sendBytes(char *, int);
+	bool sendBytes(const char *, int);
 	bool getByte(char *);
 	bool getBytes(char *, int);
 	bool applySettings(void);
@@ -55,6 +55,10 @@ public:
 	int getRXBufferSize(void);
 	bool setTXBufferSize(int);
 	int getTXBufferSize(void);
+	//bytes sent and received since the counts were last reset
+	long getBytesSent(void);
+	long getBytesReceived(void);
+	bool resetByteCounts(void);
 	Serial(void);
 	~Serial(void);
 
@@ -82,6 +86,8 @@ private:
 	//Windows specific nastiness below here
 	DWORD bytesRead;
 	DWORD bytesWritten;
+	long sentCount;
+	long receivedCount;
 	DCB * dcb;
 	COMMTIMEOUTS * timeouts;
 	OVERLAPPED * overlap;
@@ -23,12 +23,67 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
  * THE POSSIBILITY OF SUCH DAMAGE.
  */
-#include "Burn.h"
+#include "BurnGang.h"
+#include "BurnClone.h"
+#include "BankPack.h"
+#include "Manifest.h"
+#include "Timer.h"
+#include "ProgressLine.h"
+#include "StatsReport.h"
 #include <ctype.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
 #include <iostream>
+#include <iomanip>
+#include <sstream>
 using namespace std;
 
-enum Action { NOTHING, ERASE, WRITE, READ, VERIFY, BLANKCHECK, HWCHECK };
+enum Action { NOTHING, ERASE, WRITE, READ, VERIFY, BLANKCHECK, HWCHECK, CLONE, PACK };
+
+//How line mode knows the next chip is in the socket
+enum LineWait { NOLINE, KEYPRESS, BLANKPOLL };
+
+//ms between blank checks while waiting on a chip in line mode
+static const int linePollDelay = 500;
+
+static struct option longOptions[] =
+{
+   {"line", optional_argument, NULL, 'l'},
+   {"stats", required_argument, NULL, 's'},
+   {"clone", no_argument, NULL, 'c'},
+   {"pack", required_argument, NULL, 'k'},
+   {"bank", required_argument, NULL, 'B'},
+   {"cache", no_argument, NULL, 'C'},
+   {NULL, 0, NULL, 0}
+};
+
+//Lists each chip in the traits table and what can be done with it
+static string chipList(void)
+{
+   ostringstream list;
+   const ChipTraits * t;
+   string ops;
+
+   for(int i = 0; (t = Burn::getChipTraitsAt(i)) != NULL; i++)
+   {
+      ops.clear();
+      if(t->ops & CHIP_READ)
+         ops += "/Read";
+      if(t->ops & CHIP_WRITE)
+         ops += "/Write";
+      if(t->ops & CHIP_ERASE)
+         ops += "/Erase";
+      if(t->ops & CHIP_VERIFY)
+         ops += "/Verify";
+      if(t->ops & CHIP_BLANK)
+         ops += "/Blank check";
+
+      list << left << setw(12) << t->name << "- " << setw(16) << t->description
+           << "- " << ops.substr(1) << "\n";
+   }
+   return list.str();
+}
 
 static string usage =
    "Moates Burn1/2 command line interface\n"
@@ -38,173 +93,472 @@ static string usage =
    "moatesburn -p <com port> -t <type> -e           - Erase and blank check chip of <type> on Burn1/2 attached to <com port>\n"
    "moatesburn -p <com port> -t <type> -b           - Blank check chip of <type> on Burn1/2 attached to <com port>\n"
    "moatesburn -p <com port> -t <type> -w <file>    - Write and verify <file> to chip of <type> on Burn1/2 attached to <com port>\n"
-   "moatesburn -p <com port> -t <type> -r <file>    - Read chip of <type> on Burn1/2 attached to <com port> to <file>\n"
+   "moatesburn -p <com port> -t <type> -d -w <file> - Write only the pages that changed and verify, for chips without erase\n"
+   "moatesburn -p <com port> -t <type> -j <journal> -w <file> - Write and verify, picking up an earlier write of <file> that died part way\n"
+   "moatesburn -p <port>,<port>... -t <type> -w <file> - Write and verify <file> on several Burn1/2's at once\n"
+   "moatesburn -p <com port> -t <type> --line -w <file> - Production line, write <file> to one chip after another\n"
+   "                                                  waits for enter before each chip, q then enter to stop\n"
+   "moatesburn -p <com port> -t <type> --line=blank -w <file> - Same but waits until a blank chip is found\n"
+   "moatesburn -p <com port> -t <type> -r <file>    - Read chip of <type> on Burn1/2 attached to <com port> to <file>, - for stdout\n"
    "moatesburn -p <com port> -t <type> -v <file>    - Verify chip of <type> on Burn1/2 to <file>\n"
+   "moatesburn -p <from>,<to> -t <type> --clone     - Copy the chip in the burner on <from> to the one on <to>, verifies <to>\n"
+   "moatesburn -p <com port> -t <type> --pack <pack> - Write the bins listed in <pack> to their banks, only the banks that changed\n"
+   "moatesburn --bank=<n> -p <com port> -t <type> ... - Erase, blank check, write, read or verify only bank <n> of a 29f040 or EEC-IV\n"
+   "                                                  a write leaves a bank that already holds <file> alone\n"
+   "moatesburn --stats=json -p <com port> ...       - Also print how long each phase took as a line of JSON at the end\n"
+   "moatesburn -J <manifest>                        - Run the jobs listed in <manifest>, see below\n"
+   "moatesburn --cache -J <manifest>                - Same, but a write of a file a burner already wrote in the manifest\n"
+   "                                                  only spot checks the chip, only when nobody swaps chips part way\n"
    "\n"
    "Examples:\n"
    "moatesburn -p /dev/ttyUSB0 -t SST27SF512 -e        -- Erase a SST 27sf512 on the burner located at /dev/ttyUSB0\n"
    "moatesburn -p /dev/ttyUSB0 -t M2732A -r 2732.bin   -- Read a M2732 to the file 2732.bin from burner at /dev/ttyUSB0\n"
+   "moatesburn -p /dev/ttyUSB0 -t SST27SF512 -r - | sha1sum -- Hash a 27sf512 as it's read\n"
    "moatesburn -p /dev/ttyUSB0 -h                      -- Check for hardware attached to ttyUSB0 - implied in other commands\n"
+   "moatesburn -p /dev/ttyUSB0 -t AT29C256 -d -w a.bin -- Rewrite only the 64 byte pages of a 29c256 that differ from a.bin\n"
+   "moatesburn -p /dev/ttyUSB0 -t AM29F040 -j ~/.burnjournal -w a.bin -- Rerun after a failed write to carry on from the last good block\n"
+   "moatesburn -p /dev/ttyUSB0,/dev/ttyUSB1 -t SST27SF512 -w a.bin -- Write a.bin to the chips in both burners at the same time\n"
+   "moatesburn -p /dev/ttyUSB0 -t SST27SF512 --line=blank -w a.bin -- Burn a.bin to each blank chip put in the socket until killed\n"
+   "moatesburn -p /dev/ttyUSB0,/dev/ttyUSB1 -t SST27SF512 --clone -- Copy the chip in ttyUSB0 to the one in ttyUSB1\n"
+   "moatesburn -p /dev/ttyUSB0 -t AM29F040 --pack tunes.txt -- Update the tunes in a switcher's 29f040 from tunes.txt\n"
+   "moatesburn -p /dev/ttyUSB0 -t EECIV --bank=1 -v b1.bin -- Verify only bank 1 of an EEC-IV chip against b1.bin\n"
+   "\n"
+   "Files can be raw bins, placed at the end of the chip by their size, or Intel HEX\n"
+   "and Motorola S-records, placed at the addresses they give, only those are written\n"
+   "EEC-IV bins of 1, 2 or 4 banks of 56K or 64K go a bank at a time into the chip's first banks,\n"
+   "a 56K bank at the top of its 64K, only those banks are erased, written and verified\n"
    "\n"
    "Known chip types and supported commands for each type:\n"
-   "SST27SF512  - SST 27sf512     - Read/Write/Erase/Verify/Blank check\n"
-   "AM29F040    - AMD 29f040      - Read/Write/Erase/Verify/Blank check\n"
-   "EECIV       - Moates EEC 4    - Read/Write/Erase/Verify/Blank check\n"
-   "AT29C256    - ATMEL 29c256    - Read/Write/Verify/Blank check\n"
-   "M2732A      - Microchip 2732  - Read/Verify/Blank check\n"
+   + chipList() +
+   "\n"
+   "Manifests have a job per line, # starts a comment:\n"
+   "<com port> <type> <action> <file> [bank]\n"
+   "action is one of erase, blank, write, read or verify, use - for the file on erase/blank\n"
+   "a bank limits the job to that bank of a 29f040 or EEC-IV, like --bank\n"
+   "jobs on the same port run in order, different ports run at the same time\n"
+   "with --cache, writing a file a burner already wrote earlier in the manifest only spot checks the chip\n"
    "\n"
+   "Packs have a bank per line, # starts a comment:\n"
+   "<bank> <file>\n"
+   "banks not listed are left alone, each file is placed in its bank like on a chip the size of the bank\n"
    "\n" ;
 
-int main (int argc, char **argv)
+//Dumps the address ranges that failed the last verify or blank check
+static void printMismatches(Burn & b)
 {
+   std::vector<MismatchRange> m = b.getMismatches();
 
-   ChipType chip = NONE;
-   Burn MoatesBurn;
-   Action cmd = NOTHING;
-   string port;
-   string file;
-   string chipname;
-   int index;
-   int c;
+   for(unsigned int i = 0; i < m.size(); i++)
+      cerr << "Mismatch at: 0x" << hex << m[i].start << " - 0x" << m[i].end - 1 << dec << endl;
+}
 
-   opterr = 0;
+//chip type from its name on the command line or in a manifest
+static ChipType chipFromName(string name)
+{
+   const ChipTraits * t = Burn::getChipTraits(name);
 
-   while ((c = getopt (argc, argv, "p:t:w:r:v:ehb")) != -1)
-      switch (c)
-      {
-      case 'p':
-         port.assign(optarg);
-         break;
-      case 'w':
-         cmd = WRITE;
-         file.assign(optarg);
-         break;
-      case 'r':
-         cmd = READ;
-         file.assign(optarg);
-         break;
-      case 'v':
-         cmd = VERIFY;
-         file.assign(optarg);
-         break;
-      case 'e':
-         cmd = ERASE;
-         break;
-      case 'b':
-         cmd = BLANKCHECK;
-         break;
-      case 'h':
-         cmd = HWCHECK;
-         break;
-      case 't':
-         chipname.assign(optarg);
-         if( chipname == "SST27SF512" )
-         {
-            chip = SST27SF512 ;
-         }
-         else if( chipname == "AM29F040" )
-         {
-            chip = AM29F040;
-         }
-         else if( chipname == "EECIV" )
-         {
-            chip = EECIV;
-         }
-         else if( chipname == "AT29C256" )
-         {
-            chip = AT29C256;
-         }
-         else if( chipname == "M2732A" )
-         {
-            chip = M2732A;
-         }
-         else
-         {
-            cerr<< "ERROR: Chip type: " << chipname << " unknown" << endl;
-            cerr << usage;
-            return false;
-         }
-         break;
-      case '?':
-         if (optopt != 'e'  && optopt != 'h' && optopt != 'b')
-         {
-            cerr << "ERROR: Option -"<< (char) optopt << "requires an argument" << endl;
-            cerr<< usage;
-            return false;
-         }
-         else if (isprint(optopt))
-         {
-            cerr << "ERROR: Unknown option -" <<	(char) optopt << endl;
-            cerr << usage;
-            return false;
-         }
-         else
-         {
-            cerr << "ERROR: Unknown option character " << hex << optopt << endl;
-            cerr << usage;
-            return false;
-         }
-      default:
+   return t ? t->type : NONE;
+}
+
+//true if the chip supports the ChipOp passed
+static bool chipCan(ChipType chip, int op)
+{
+   const ChipTraits * t = Burn::getChipTraits(chip);
+
+   return t != NULL && (t->ops & op);
+}
+
+//Runs one burner's jobs from a manifest on its own thread, the port is
+//opened and the device found once, then each job is done in turn
+//Nothing is printed here so the threads don't step on each other
+//The arg says whether to cache writes, which is only safe if the chips
+//stay put for the whole manifest, nothing here can tell if they don't
+static bool burnJobs(string port, vector<ManifestJob *> & jobs, void * cache)
+{
+   Burn * b = new Burn;
+   bool found = b->setComPort(port) && b->checkForDevice();
+   ManifestJob * j;
+   ChipType chip;
+   long started;
+
+   //writing the same bin to a burner twice only spot checks it the
+   //second time
+   b->setWriteCache(*(bool *) cache);
+
+   for(unsigned int i = 0; i < jobs.size(); i++)
+   {
+      j = jobs[i];
+      started = Timer::currentMillis();
+      chip = chipFromName(j->chip);
+
+      if(!found)
+         j->message = "device not found";
+      else if(chip == NONE || !b->setChipType(chip))
+         j->message = "unknown chip type";
+      else if(j->bank >= 0 && (Burn::getChipTraits(chip)->banks < 2 || !b->setBank(j->bank)))
+         j->message = "no such bank";
+      else if(j->action == "erase")
+         j->ok = j->bank < 0 ? b->eraseChip() && b->verifyChipIsBlank() :
+                 b->eraseBankAndWait(j->bank) && b->verifyBankIsBlank();
+      else if(j->action == "blank")
+         j->ok = j->bank < 0 ? b->verifyChipIsBlank() : b->verifyBankIsBlank();
+      else if(j->action == "write")
       {
-         cerr << usage;
-         return false;
-      }
+         j->ok = b->setBinFile(j->file) &&
+                 (j->bank < 0 ? b->writeFileToChip() : b->writeFileToBank());
+         if(b->getWriteSkipped())
+            j->message = "already on chip, spot checked";
       }
+      else if(j->action == "read")
+         j->ok = b->setBinFile(j->file) &&
+                 (j->bank < 0 ? b->readChipToFile() : b->readBankToFile());
+      else if(j->action == "verify")
+         j->ok = b->setBinFile(j->file) &&
+                 (j->bank < 0 ? b->verifyChipToFile() : b->verifyBankToFile());
+      else
+         j->message = "unknown action";
 
-   if(port.empty())
+      j->millis = Timer::currentMillis() - started;
+      j->done = true;
+   }
+
+   delete b;
+   return found;
+}
+
+//Loads and runs a manifest then lists how each job went
+static bool runManifest(string file, bool cache)
+{
+   Manifest m;
+   vector<ManifestJob> jobs;
+   int worked = 0;
+
+   if(!m.setFile(file) || !m.load())
    {
-      cerr << "ERROR: Com port must be provided." << endl << usage;
+      cerr << "ERROR: " << m.getError() << endl;
       return false;
    }
-   if(cmd != HWCHECK && chip == NONE)
+
+   m.run(burnJobs, &cache);
+
+   jobs = m.getJobs();
+   for(unsigned int i = 0; i < jobs.size(); i++)
    {
-      cerr << "ERROR: Chip type must be provided for functions other than hardware check" << endl << usage;
+      cout << "line " << jobs[i].line << ": " << jobs[i].device << " " << jobs[i].action << " "
+           << jobs[i].chip << " " << jobs[i].file << ".... " << (jobs[i].ok ? "Success!" : "Failed!");
+      if(!jobs[i].message.empty())
+         cout << " " << jobs[i].message;
+      cout << " in " << jobs[i].millis << "ms" << endl;
+      if(jobs[i].ok)
+         worked++;
+   }
+   cout << worked << " of " << jobs.size() << " jobs worked, took " << m.getElapsed() << "ms" << endl;
+
+   return worked == (int) jobs.size();
+}
+
+//splits a comma separated list of ports
+static vector<string> splitPorts(string s)
+{
+   vector<string> ports;
+   string::size_type start = 0, comma;
+
+   do
+   {
+      comma = s.find(',', start);
+      if(comma != start && start < s.size())
+         ports.push_back(s.substr(start, comma == string::npos ? string::npos : comma - start));
+      start = comma + 1;
+   }
+   while(comma != string::npos);
+
+   return ports;
+}
+
+//Writes the file to every burner in the list at once and reports on each
+//then the total, returns true only if every chip was written and verified
+static bool gangWrite(vector<string> ports, ChipType chip, string chipname, string file, bool differential)
+{
+   BurnGang gang;
+   vector<GangResult> res;
+   long ms;
+
+   gang.setPorts(ports);
+   gang.setChipType(chip);
+   gang.setBinFile(file);
+   gang.setDifferentialWrite(differential);
+
+   if(!gang.readFileToMemory())
+   {
+      cerr << "ERROR: couldn't read file " << file << endl;
       return false;
    }
-   if((cmd == READ || cmd == WRITE || cmd == VERIFY) && file.empty())
+
+   cout << "Writing file: " << file << " to chip: " << chipname << " on "
+        << ports.size() << " burners.... " << endl;
+   gang.writeFileToChips();
+
+   res = gang.getResults();
+   for(unsigned int i = 0; i < res.size(); i++)
    {
-      cerr << "ERROR: Filename must be provided for Read/Write/Verify functions" << endl << usage;
+      cout << res[i].port << ": " << (res[i].ok ? "Success!" : "Failed! ")
+           << (res[i].ok ? "" : res[i].failedAt) << " in " << res[i].millis << "ms";
+      if(res[i].blocksRetried > 0)
+         cout << ", blocks retried: " << res[i].blocksRetried << " (" << res[i].retryCount << " retries)";
+      cout << endl;
+      for(unsigned int j = 0; j < res[i].mismatches.size(); j++)
+         cerr << res[i].port << ": Mismatch at: 0x" << hex << res[i].mismatches[j].start
+              << " - 0x" << res[i].mismatches[j].end - 1 << dec << endl;
+   }
+
+   ms = gang.getElapsed() > 0 ? gang.getElapsed() : 1;
+   cout << "Wrote " << gang.getChipsWritten() << " of " << res.size() << " chips, "
+        << gang.getBytesWritten() << " bytes in " << ms << "ms ("
+        << gang.getBytesWritten() * 1000 / ms / 1024 << " KB/s)" << endl;
+
+   return gang.getChipsWritten() == (int) res.size();
+}
+
+//Copies the chip in the burner on the first port to the one on the second,
+//the target is written as the source is read, then verified
+static bool cloneChip(vector<string> ports, ChipType chip, string chipname)
+{
+   BurnClone clone;
+   ProgressLine line;
+   ostringstream what;
+   vector<GangResult> res;
+   long ms;
+   bool ok;
+
+   if(!clone.setPorts(ports[0], ports[1]) || !clone.setChipType(chip))
+   {
+      cerr << "ERROR: can't clone from " << ports[0] << " to " << ports[1] << endl;
       return false;
    }
+   if(line.isEnabled())
+      clone.setProgressObserver(&line);
+
+   what << "Cloning chip: " << chipname << " from " << ports[0] << " to " << ports[1] << ".... ";
+   cout << what.str() << flush;
+   line.setLabel(what.str());
+   ok = clone.cloneChip();
+   line.finish();
+   cout << (ok ? " Success!" : " Failed!") << endl;
 
-   if( !MoatesBurn.setComPort(port) )
+   res = clone.getResults();
+   for(unsigned int i = 0; i < res.size(); i++)
    {
-      cerr << "ERROR: couldn't open com port " << port << endl;
+      cout << res[i].port << (i == 0 ? " (source): " : " (target): ")
+           << (res[i].ok ? "Success!" : "Failed! ") << (res[i].ok ? "" : res[i].failedAt);
+      if(res[i].blocksRetried > 0)
+         cout << ", blocks retried: " << res[i].blocksRetried << " (" << res[i].retryCount << " retries)";
+      cout << endl;
+      for(unsigned int j = 0; j < res[i].mismatches.size(); j++)
+         cerr << res[i].port << ": Mismatch at: 0x" << hex << res[i].mismatches[j].start
+              << " - 0x" << res[i].mismatches[j].end - 1 << dec << endl;
+   }
+
+   if(ok)
+   {
+      ms = clone.getElapsed() > 0 ? clone.getElapsed() : 1;
+      cout << "Copied " << clone.getBytesCopied() << " bytes in " << ms << "ms ("
+           << clone.getBytesCopied() * 1000 / ms / 1024 << " KB/s)" << endl;
+   }
+   return ok;
+}
+
+//only says anything if some blocks had to be sent again
+static void printRetries(Burn & b)
+{
+   if(b.getBlocksRetried() > 0)
+      cout << "Blocks retried: " << b.getBlocksRetried()
+           << " (" << b.getRetryCount() << " retries)" << endl;
+}
+
+//Writes each bin in the pack to its bank, banks that already hold
+//theirs are only read and compared
+static bool packWrite(Burn & b, ChipType chip, string chipname, string file)
+{
+   BankPack pack;
+   ProgressLine line;
+   ostringstream what;
+   vector<PackBank> banks;
+   bool ok;
+
+   if(!pack.setFile(file) || !pack.load())
+   {
+      cerr << "ERROR: " << pack.getError() << endl;
       return false;
    }
-   else
-      cout << "Opened com port: " << port << " OK" << endl;
+   if(!b.setChipType(chip))
+      return false;
+   if(line.isEnabled())
+      b.setProgressObserver(&line);
 
-   if( ! MoatesBurn.checkForDevice() )
+   what << "Packing " << file << " into chip: " << chipname << ".... ";
+   cout << what.str() << flush;
+   line.setLabel(what.str());
+   ok = pack.write(b);
+   line.finish();
+   cout << (ok ? " Success!" : " Failed!") << endl;
+
+   banks = pack.getBanks();
+   for(unsigned int i = 0; i < banks.size(); i++)
    {
-      cerr << "ERROR: device not found" << endl;
+      cout << "bank " << banks[i].bank << ": " << banks[i].file << ".... ";
+      if(!banks[i].ok)
+         cout << "Failed! " << banks[i].failedAt;
+      else
+         cout << (banks[i].written ? "written" : "unchanged");
+      cout << " in " << banks[i].millis << "ms" << endl;
+   }
+   cout << "Rewrote " << pack.getBanksWritten() << " of " << banks.size() << " banks" << endl;
+   printRetries(b);
+   printMismatches(b);
+
+   return ok;
+}
+
+//local time for the line mode log
+static string timeStamp(void)
+{
+   char buf[32];
+   time_t now = time(NULL);
+
+   strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime(&now));
+   return buf;
+}
+
+//Keeps the port open and the file loaded, for each chip it waits on the
+//operator, then erases, writes and verifies and logs how it went
+//Waiting on a blank chip just keeps blank checking until one reads blank,
+//the chip that was just written won't so it has to be swapped first
+static bool lineWrite(Burn & b, ChipType chip, string chipname, string file, LineWait wait)
+{
+   Image image;
+   string line;
+   int chips = 0, passed = 0;
+   long started;
+   bool ok;
+
+   if(!b.setChipType(chip) || !Burn::loadImage(image, file, chip) || !b.setImage(&image))
+   {
+      cerr << "ERROR: couldn't load file " << file << " for chip: " << chipname << endl;
       return false;
    }
-   else
+
+   cout << "Line mode writing file: " << file << " to chip: " << chipname << endl;
+   for(;;)
    {
-      cout << "Found device! Version is: "
-           << (int) MoatesBurn.getHardwareVersion() << "."
-           << (int) MoatesBurn.getFirmwareVersion() << "."
-           <<  MoatesBurn.getHardwareVersionCH()
-           << endl;
-      if( cmd == HWCHECK)
-         return true;
+      if(wait == KEYPRESS)
+      {
+         cout << "Put chip " << chips + 1 << " in and press enter, q then enter to stop: " << flush;
+         if(!getline(cin, line) || line == "q")
+            break;
+      }
+      else
+      {
+         cout << "Waiting for a blank chip...." << flush;
+         while(!b.verifyChipIsBlank())
+         {
+            //every poll is a phase, nothing reports them here
+            b.clearPhaseTimes();
+            Timer::sleepMillis(linePollDelay);
+         }
+         cout << endl;
+      }
+
+      chips++;
+      b.resetRetryStats();
+      b.clearPhaseTimes();
+      started = Timer::currentMillis();
+      ok = b.writeFileToChip();
+      if(ok)
+         passed++;
+
+      cout << timeStamp() << " chip " << chips << ": " << (ok ? "Success!" : "Failed!")
+           << " in " << Timer::currentMillis() - started << "ms, "
+           << passed << " passed, " << chips - passed << " failed" << endl;
+      printRetries(b);
+      if(!ok)
+         printMismatches(b);
+   }
+
+   cout << "Wrote " << passed << " of " << chips << " chips" << endl;
+   return passed == chips;
+}
+
+//Names the action the way manifests do
+static const char * actionName(Action a)
+{
+   switch(a)
+   {
+   case ERASE:
+      return "erase";
+   case WRITE:
+      return "write";
+   case READ:
+      return "read";
+   case VERIFY:
+      return "verify";
+   case BLANKCHECK:
+      return "blank";
+   case HWCHECK:
+      return "check";
+   case CLONE:
+      return "clone";
+   case PACK:
+      return "pack";
+   default:
+      return "";
    }
+}
+
+//Runs a single job on a burner that's already been found
+//A bank of -1 is the whole chip, otherwise only that bank is touched
+static bool runCommand(Burn & MoatesBurn, Action cmd, ChipType chip, string chipname, string file, int bank)
+{
+   //the progress is drawn after whatever's printed about the job
+   ProgressLine line;
+   ostringstream what;
+   bool whole = bank < 0;
+   if(line.isEnabled())
+      MoatesBurn.setProgressObserver(&line);
+
+   if(!whole)
+   {
+      if(!MoatesBurn.setChipType(chip) || !MoatesBurn.setBank(bank))
+      {
+         cerr << "ERROR: chip: " << chipname << " has no bank " << bank << endl;
+         return false;
+      }
+      chipname += " bank " + string(1, (char) ('0' + bank));
+   }
+
    switch(cmd)
    {
    case ERASE:
-      if(chip ==SST27SF512 || chip == AM29F040 || chip == EECIV)
+      if(chipCan(chip, CHIP_ERASE))
       {
-         cout << "Erasing " << chipname  <<  ".... " << flush;
+         what << "Erasing " << chipname  << ".... ";
+         cout << what.str() << flush;
+         line.setLabel(what.str());
          if(	MoatesBurn.setChipType(chip) &&
-               MoatesBurn.eraseChip() &&
-               MoatesBurn.verifyChipIsBlank())
+               (whole ? MoatesBurn.eraseChip() : MoatesBurn.eraseBankAndWait(bank)) &&
+               (whole ? MoatesBurn.verifyChipIsBlank() : MoatesBurn.verifyBankIsBlank()))
          {
+            line.finish();
             cout << " Success!" << endl;
+            printRetries(MoatesBurn);
             return true;
          }
          else
+         {
+            line.finish();
             cout << " Failed!" << endl;
+            printRetries(MoatesBurn);
+            printMismatches(MoatesBurn);
+         }
 
       }
       else
@@ -214,18 +568,31 @@ int main (int argc, char **argv)
       break;
 
    case WRITE:
-      if(chip ==SST27SF512 || chip == AM29F040 || chip == EECIV || chip == AT29C256)
+      if(chipCan(chip, CHIP_WRITE))
       {
-         cout << "Writing file: " << file << " to chip: "<< chipname  <<  ".... " << flush;
+         what << "Writing file: " << file << " to chip: "<< chipname  << ".... ";
+         cout << what.str() << flush;
+         line.setLabel(what.str());
          if(	MoatesBurn.setChipType(chip) &&
                MoatesBurn.setBinFile(file) &&
-               MoatesBurn.writeFileToChip())
+               (whole ? MoatesBurn.writeFileToChip() : MoatesBurn.writeFileToBank()))
          {
+            line.finish();
             cout << " Success!" << endl;
+            printRetries(MoatesBurn);
+            if(MoatesBurn.getDifferentialWrite() && !chipCan(chip, CHIP_ERASE))
+               cout << "Pages rewritten: " << MoatesBurn.getPagesWritten() << endl;
+            if(!whole && MoatesBurn.getWriteSkipped())
+               cout << "Bank already held the file, left alone" << endl;
             return true;
          }
          else
+         {
+            line.finish();
             cout << " Failed!" << endl;
+            printRetries(MoatesBurn);
+            printMismatches(MoatesBurn);
+         }
 
       }
       else
@@ -235,19 +602,26 @@ int main (int argc, char **argv)
       break;
 
    case READ:
-      if(chip ==SST27SF512 || chip == AM29F040 || chip == EECIV || chip == AT29C256 || chip == M2732A )
+      if(chipCan(chip, CHIP_READ))
       {
-         cout << "Reading chip: " << chipname << " to file: "<< file  <<  ".... " << flush;
+         what << "Reading chip: " << chipname << " to file: "<< file  << ".... ";
+         cout << what.str() << flush;
+         line.setLabel(what.str());
          if(	MoatesBurn.setChipType(chip) &&
                MoatesBurn.setBinFile(file) &&
-               MoatesBurn.readChipToMemory() &&
-               MoatesBurn.writeMemoryToFile() )
+               (whole ? MoatesBurn.readChipToFile() : MoatesBurn.readBankToFile()) )
          {
+            line.finish();
             cout << " Success!" << endl;
+            printRetries(MoatesBurn);
             return true;
          }
          else
+         {
+            line.finish();
             cout << " Failed!" << endl;
+            printRetries(MoatesBurn);
+         }
       }
       else
          cout<< "Can't read from chip of type: " << chipname << endl;
@@ -256,18 +630,27 @@ int main (int argc, char **argv)
       break;
 
    case VERIFY:
-      if(chip ==SST27SF512 || chip == AM29F040 || chip == EECIV || chip == AT29C256 || chip == M2732A )
+      if(chipCan(chip, CHIP_VERIFY))
       {
-         cout << "Verifing chip: " << chipname << " to file: "<< file  <<  ".... " << flush;
+         what << "Verifing chip: " << chipname << " to file: "<< file  << ".... ";
+         cout << what.str() << flush;
+         line.setLabel(what.str());
          if(	MoatesBurn.setChipType(chip) &&
                MoatesBurn.setBinFile(file) &&
-               MoatesBurn.verifyChipToFile() )
+               (whole ? MoatesBurn.verifyChipToFile() : MoatesBurn.verifyBankToFile()) )
          {
+            line.finish();
             cout << " Success!" << endl;
+            printRetries(MoatesBurn);
             return true;
          }
          else
+         {
+            line.finish();
             cout << " Failed!" << endl;
+            printRetries(MoatesBurn);
+            printMismatches(MoatesBurn);
+         }
       }
       else
          cout<< "Can't verify against chip of type: " << chipname << endl;
@@ -276,26 +659,350 @@ int main (int argc, char **argv)
       break;
 
    case BLANKCHECK:
-      if(chip ==SST27SF512 || chip == AM29F040 || chip == EECIV || chip == AT29C256 || chip == M2732A )
+      if(chipCan(chip, CHIP_BLANK))
       {
-         cout << "Verifing chip: " << chipname << " is blank " <<  ".... " << flush;
+         what << "Verifing chip: " << chipname << " is blank " << ".... ";
+         cout << what.str() << flush;
+         line.setLabel(what.str());
          if(	MoatesBurn.setChipType(chip) &&
                MoatesBurn.setBinFile(file) &&
-               MoatesBurn.verifyChipIsBlank() )
+               (whole ? MoatesBurn.verifyChipIsBlank() : MoatesBurn.verifyBankIsBlank()) )
          {
+            line.finish();
             cout << " Success!" << endl;
+            printRetries(MoatesBurn);
             return true;
          }
          else
+         {
+            line.finish();
             cout << " Failed!" << endl;
+            printRetries(MoatesBurn);
+            printMismatches(MoatesBurn);
+         }
       }
       else
          cout<< "Can't blank check chip of type: " << chipname << endl;
 
       return false;
 
-
+   //the rest are handled before getting here
+   default:
+      return false;
    }
    return false;
 }
 
+//Prints the timing report if one was asked for, passes on how the job went
+static bool reportStats(StatsReport & stats, Burn & b, bool ok)
+{
+   if(stats.isEnabled())
+   {
+      stats.addPhases(b.getPhaseTimes());
+      stats.setBytes(b.getBytesSent(), b.getBytesReceived());
+      stats.setRetries(b.getRetryCount(), b.getBlocksRetried());
+      stats.setResult(ok);
+      stats.writeJson(cout);
+   }
+   return ok;
+}
+
+int main (int argc, char **argv)
+{
+
+   ChipType chip = NONE;
+   Burn MoatesBurn;
+   Action cmd = NOTHING;
+   LineWait lineWait = NOLINE;
+   string port;
+   vector<string> ports;
+   string file;
+   string manifest;
+   string chipname;
+   StatsReport stats;
+   long started;
+   bool ok;
+   bool cache = false;
+   int bank = -1;
+   char * end;
+   int index;
+   int c;
+
+   opterr = 0;
+
+   while ((c = getopt_long (argc, argv, "p:t:w:r:v:j:J:ehbd", longOptions, NULL)) != -1)
+      switch (c)
+      {
+      case 'p':
+         ports = splitPorts(optarg);
+         if(!ports.empty())
+            port = ports[0];
+         break;
+      case 'w':
+         cmd = WRITE;
+         file.assign(optarg);
+         break;
+      case 'r':
+         cmd = READ;
+         file.assign(optarg);
+         break;
+      case 'v':
+         cmd = VERIFY;
+         file.assign(optarg);
+         break;
+      case 'e':
+         cmd = ERASE;
+         break;
+      case 'b':
+         cmd = BLANKCHECK;
+         break;
+      case 'c':
+         cmd = CLONE;
+         break;
+      case 'k':
+         cmd = PACK;
+         file.assign(optarg);
+         break;
+      case 'B':
+         bank = strtol(optarg, &end, 0);
+         if(*end != '\0' || bank < 0)
+         {
+            cerr << "ERROR: bad bank: " << optarg << endl;
+            cerr << usage;
+            return false;
+         }
+         break;
+      case 'h':
+         cmd = HWCHECK;
+         break;
+      case 'd':
+         MoatesBurn.setDifferentialWrite(true);
+         break;
+      case 'j':
+         MoatesBurn.setJournalFile(optarg);
+         break;
+      case 'J':
+         manifest.assign(optarg);
+         break;
+      case 'C':
+         cache = true;
+         break;
+      case 's':
+         if(string(optarg) != "json")
+         {
+            cerr << "ERROR: --stats can only be json, not: " << optarg << endl;
+            cerr << usage;
+            return false;
+         }
+         stats.setEnabled(true);
+         break;
+      case 'l':
+         if(optarg == NULL || string(optarg) == "key")
+            lineWait = KEYPRESS;
+         else if(string(optarg) == "blank")
+            lineWait = BLANKPOLL;
+         else
+         {
+            cerr << "ERROR: --line can wait on key or blank, not: " << optarg << endl;
+            cerr << usage;
+            return false;
+         }
+         break;
+      case 't':
+         chipname.assign(optarg);
+         if( (chip = chipFromName(chipname)) == NONE )
+         {
+            cerr<< "ERROR: Chip type: " << chipname << " unknown" << endl;
+            cerr << usage;
+            return false;
+         }
+         break;
+      case '?':
+         if (optopt != 'e'  && optopt != 'h' && optopt != 'b' && optopt != 'd')
+         {
+            cerr << "ERROR: Option -"<< (char) optopt << "requires an argument" << endl;
+            cerr<< usage;
+            return false;
+         }
+         else if (isprint(optopt))
+         {
+            cerr << "ERROR: Unknown option -" <<	(char) optopt << endl;
+            cerr << usage;
+            return false;
+         }
+         else
+         {
+            cerr << "ERROR: Unknown option character " << hex << optopt << endl;
+            cerr << usage;
+            return false;
+         }
+      default:
+      {
+         cerr << usage;
+         return false;
+      }
+      }
+
+   //a read to stdout gets the chip and nothing else, the rest goes to stderr
+   if(cmd == READ && file == "-")
+      cout.rdbuf(cerr.rdbuf());
+
+   //the report covers one job on one burner
+   if(stats.isEnabled() && (!manifest.empty() || ports.size() > 1 || lineWait != NOLINE))
+   {
+      cerr << "ERROR: --stats=json is only for a single job on a single port" << endl << usage;
+      return false;
+   }
+
+   if(cache && manifest.empty())
+   {
+      cerr << "ERROR: --cache only applies to manifests" << endl << usage;
+      return false;
+   }
+
+   //Manifests carry their own ports and chips
+   if(!manifest.empty())
+      return runManifest(manifest, cache);
+
+   if(port.empty())
+   {
+      cerr << "ERROR: Com port must be provided." << endl << usage;
+      return false;
+   }
+   if(cmd != HWCHECK && chip == NONE)
+   {
+      cerr << "ERROR: Chip type must be provided for functions other than hardware check" << endl << usage;
+      return false;
+   }
+   if((cmd == READ || cmd == WRITE || cmd == VERIFY || cmd == PACK) && file.empty())
+   {
+      cerr << "ERROR: Filename must be provided for Read/Write/Verify functions" << endl << usage;
+      return false;
+   }
+
+   if(lineWait != NOLINE && (cmd != WRITE || ports.size() > 1))
+   {
+      cerr << "ERROR: Line mode only writes, to a single port" << endl << usage;
+      return false;
+   }
+
+   if(bank >= 0)
+   {
+      if(Burn::getChipTraits(chip) == NULL || Burn::getChipTraits(chip)->banks < 2)
+      {
+         cout<< "Chip of type: " << chipname << " doesn't have banks" << endl;
+         return false;
+      }
+      if(cmd == PACK || cmd == CLONE || cmd == HWCHECK || ports.size() > 1 || lineWait != NOLINE ||
+            !MoatesBurn.getJournalFile().empty() || MoatesBurn.getDifferentialWrite())
+      {
+         cerr << "ERROR: --bank is only for a single erase, blank check, write, read or verify, without a journal" << endl << usage;
+         return false;
+      }
+   }
+
+   if(cmd == PACK)
+   {
+      if(Burn::getChipTraits(chip)->banks < 2 || !chipCan(chip, CHIP_ERASE) || !chipCan(chip, CHIP_WRITE))
+      {
+         cout<< "Cant pack banks on chip of type: " << chipname << endl;
+         return false;
+      }
+      if(!MoatesBurn.getJournalFile().empty() || MoatesBurn.getDifferentialWrite())
+      {
+         cerr << "ERROR: Journals and differential writes can't be used with --pack" << endl << usage;
+         return false;
+      }
+   }
+
+   //A clone reads the chip in one burner and writes it to the other
+   if(cmd == CLONE)
+   {
+      if(ports.size() != 2)
+      {
+         cerr << "ERROR: --clone needs two ports, the burner to copy from then the one to copy to" << endl << usage;
+         return false;
+      }
+      if(!MoatesBurn.getJournalFile().empty() || MoatesBurn.getDifferentialWrite())
+      {
+         cerr << "ERROR: Journals and differential writes can't be used with --clone" << endl << usage;
+         return false;
+      }
+      if(!chipCan(chip, CHIP_READ) || !chipCan(chip, CHIP_WRITE))
+      {
+         cout<< "Cant clone chip of type: " << chipname << endl;
+         return false;
+      }
+      return cloneChip(ports, chip, chipname);
+   }
+
+   //More than one port is a gang write, each burner gets its own Burn
+   if(ports.size() > 1)
+   {
+      if(cmd != WRITE)
+      {
+         cerr << "ERROR: Only writes can be done on more than one port at once" << endl << usage;
+         return false;
+      }
+      if(!MoatesBurn.getJournalFile().empty())
+      {
+         cerr << "ERROR: Journals can't be used writing to more than one port at once" << endl << usage;
+         return false;
+      }
+      if(!chipCan(chip, CHIP_WRITE))
+      {
+         cout<< "Cant write chip of type: " << chipname << endl;
+         return false;
+      }
+      return gangWrite(ports, chip, chipname, file, MoatesBurn.getDifferentialWrite());
+   }
+
+   stats.setTool("burn");
+   stats.setPort(port);
+   stats.setAction(actionName(cmd));
+   stats.setTarget(chipname);
+   stats.setFile(file);
+
+   started = Timer::currentMillis();
+   ok = MoatesBurn.setComPort(port);
+   stats.addPhase("open", started);
+   if( !ok )
+   {
+      cerr << "ERROR: couldn't open com port " << port << endl;
+      return reportStats(stats, MoatesBurn, false);
+   }
+   else
+      cout << "Opened com port: " << port << " OK" << endl;
+
+   started = Timer::currentMillis();
+   ok = MoatesBurn.checkForDevice();
+   stats.addPhase("negotiate", started);
+   if( !ok )
+   {
+      cerr << "ERROR: device not found" << endl;
+      return reportStats(stats, MoatesBurn, false);
+   }
+   else
+   {
+      cout << "Found device! Version is: "
+           << (int) MoatesBurn.getHardwareVersion() << "."
+           << (int) MoatesBurn.getFirmwareVersion() << "."
+           <<  MoatesBurn.getHardwareVersionCH()
+           << endl;
+      if( cmd == HWCHECK)
+         return reportStats(stats, MoatesBurn, true);
+   }
+   if(cmd == PACK)
+      return reportStats(stats, MoatesBurn, packWrite(MoatesBurn, chip, chipname, file));
+   if(lineWait != NOLINE)
+   {
+      if(!chipCan(chip, CHIP_WRITE))
+      {
+         cout<< "Cant write chip of type: " << chipname << endl;
+         return false;
+      }
+      return lineWrite(MoatesBurn, chip, chipname, file, lineWait);
+   }
+   ok = runCommand(MoatesBurn, cmd, chip, chipname, file, bank);
+   return reportStats(stats, MoatesBurn, ok);
+}
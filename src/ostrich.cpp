@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2012, Keith Daigle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.  Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions and
+ * the following disclaimer in the documentation and/or other materials
+ * provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Ostrich.h"
+#include "Manifest.h"
+#include "Timer.h"
+#include "ProgressLine.h"
+#include "StatsReport.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+enum Action { NOTHING, WRITE, READ, VERIFY, HWCHECK };
+
+static struct option longOptions[] =
+{
+   {"stats", required_argument, NULL, 's'},
+   {NULL, 0, NULL, 0}
+};
+
+static string usage =
+   "Moates Ostrich command line interface\n"
+   "\n"
+   "Command can be used in one of the following fashions:\n"
+   "ostrich -p <com port> -h                  - Test for Ostrich hardware on port supplied in <com port>\n"
+   "ostrich -p <com port> [-b <bank>] -w <file> - Write and verify <file> to <bank> of the Ostrich on <com port>\n"
+   "ostrich -p <com port> [-b <bank>] -j <journal> -w <file> - Write and verify, picking up an earlier write of <file> that died part way\n"
+   "ostrich -p <com port> [-b <bank>] -c <cache> -w <file> - Write and verify, unless <cache> says <file> is already in <bank>\n"
+   "                                          and a spot check agrees\n"
+   "ostrich -p <com port> [-b <bank>] -r <file> - Read <bank> of the Ostrich on <com port> to <file>, - for stdout\n"
+   "ostrich -p <com port> [-b <bank>] -v <file> - Verify <bank> of the Ostrich on <com port> against <file>\n"
+   "ostrich [-c <cache>] -J <manifest>        - Run the jobs listed in <manifest>, see below\n"
+   "ostrich --stats=json -p <com port> ...    - Also print how long each phase took as a line of JSON at the end\n"
+   "\n"
+   "Files can be raw bins, placed at the end of the chip by their size, or Intel HEX\n"
+   "and Motorola S-records, placed at the addresses they give, only those are written\n"
+   "\n"
+   "Banks are 0-7 for the 64k banks, or 8 for the whole 512k, which is the default\n"
+   "\n"
+   "Examples:\n"
+   "ostrich -p /dev/ttyUSB0 -b 2 -w a.bin     -- Write a.bin to bank 2 of the Ostrich at /dev/ttyUSB0\n"
+   "ostrich -p /dev/ttyUSB0 -r all.bin        -- Read the whole Ostrich at /dev/ttyUSB0 to all.bin\n"
+   "ostrich -p /dev/ttyUSB0 -b 3 -r - | gzip > 3.bin.gz -- Archive bank 3 as it's read\n"
+   "ostrich -p /dev/ttyUSB0 -b 1 -c ~/.ostrichcache -w tune.bin -- Push tune.bin to bank 1, quick if it's already there\n"
+   "\n"
+   "Manifests have a job per line, # starts a comment:\n"
+   "<com port> - <action> <file> [bank]\n"
+   "action is one of write, read or verify, the - is where burn takes a chip type\n"
+   "jobs on the same port run in order, different ports run at the same time\n"
+   "\n" ;
+
+//Runs one Ostrich's jobs from a manifest on its own thread, the device
+//is found once, then each job is done in turn on the bank it gives
+//Nothing is printed here so the threads don't step on each other
+//The arg is the name of the write cache file, empty for none
+static bool ostrichJobs(string port, vector<ManifestJob *> & jobs, void * arg)
+{
+   Ostrich * emu = new Ostrich;
+   bool found = emu->setComPort(port) && emu->checkForDevice();
+   ManifestJob * j;
+   long started;
+
+   emu->setCacheFile(*(string *) arg);
+
+   for(unsigned int i = 0; i < jobs.size(); i++)
+   {
+      j = jobs[i];
+      started = Timer::currentMillis();
+
+      if(!found)
+         j->message = "device not found";
+      else if(!emu->setBank(j->bank < 0 ? (int) Ostrich::wholeEnchilada : j->bank, 'U'))
+         j->message = "couldn't set bank";
+      else if(j->action == "write")
+      {
+         j->ok = emu->setBinFile(j->file) && emu->writeFileToBank();
+         if(emu->getWriteSkipped())
+            j->message = "already in bank, spot checked";
+      }
+      else if(j->action == "read")
+         j->ok = emu->setBinFile(j->file) && emu->readBankToFile();
+      else if(j->action == "verify")
+         j->ok = emu->setBinFile(j->file) && emu->verifyBankToFile();
+      else
+         j->message = "unknown action";
+
+      j->millis = Timer::currentMillis() - started;
+      j->done = true;
+   }
+
+   delete emu;
+   return found;
+}
+
+//Loads and runs a manifest then lists how each job went
+static bool runManifest(string file, string cacheFile)
+{
+   Manifest m;
+   vector<ManifestJob> jobs;
+   int worked = 0;
+
+   if(!m.setFile(file) || !m.load())
+   {
+      cerr << "ERROR: " << m.getError() << endl;
+      return false;
+   }
+
+   m.run(ostrichJobs, &cacheFile);
+
+   jobs = m.getJobs();
+   for(unsigned int i = 0; i < jobs.size(); i++)
+   {
+      cout << "line " << jobs[i].line << ": " << jobs[i].device << " " << jobs[i].action << " "
+           << jobs[i].file << " bank " << (jobs[i].bank < 0 ? (int) Ostrich::wholeEnchilada : jobs[i].bank)
+           << ".... " << (jobs[i].ok ? "Success!" : "Failed!");
+      if(!jobs[i].message.empty())
+         cout << " " << jobs[i].message;
+      cout << " in " << jobs[i].millis << "ms" << endl;
+      if(jobs[i].ok)
+         worked++;
+   }
+   cout << worked << " of " << jobs.size() << " jobs worked, took " << m.getElapsed() << "ms" << endl;
+
+   return worked == (int) jobs.size();
+}
+
+//Names the action the way manifests do
+static const char * actionName(Action a)
+{
+   switch(a)
+   {
+   case WRITE:
+      return "write";
+   case READ:
+      return "read";
+   case VERIFY:
+      return "verify";
+   case HWCHECK:
+      return "check";
+   default:
+      return "";
+   }
+}
+
+//Runs a single job on a bank that's already been set
+static bool runCommand(Ostrich & emu, Action cmd, int bank, string file)
+{
+   //the progress is drawn after whatever's printed about the job
+   ProgressLine line;
+   ostringstream what;
+   if(line.isEnabled())
+      emu.setProgressObserver(&line);
+
+   switch(cmd)
+   {
+   case WRITE:
+      what << "Writing file: " << file << " to bank: " << bank << ".... ";
+      cout << what.str() << flush;
+      line.setLabel(what.str());
+      if(emu.setBinFile(file) && emu.writeFileToBank())
+      {
+         line.finish();
+         cout << " Success!";
+         if(emu.getWriteSkipped())
+            cout << " (already in bank, spot checked)";
+         cout << endl;
+         return true;
+      }
+      break;
+
+   case READ:
+      what << "Reading bank: " << bank << " to file: " << file << ".... ";
+      cout << what.str() << flush;
+      line.setLabel(what.str());
+      if(emu.setBinFile(file) && emu.readBankToFile())
+      {
+         line.finish();
+         cout << " Success!" << endl;
+         return true;
+      }
+      break;
+
+   case VERIFY:
+      what << "Verifing bank: " << bank << " to file: " << file << ".... ";
+      cout << what.str() << flush;
+      line.setLabel(what.str());
+      if(emu.setBinFile(file) && emu.verifyBankToFile())
+      {
+         line.finish();
+         cout << " Success!" << endl;
+         return true;
+      }
+      break;
+
+   default:
+      return false;
+   }
+
+   line.finish();
+   cout << " Failed!" << endl;
+   return false;
+}
+
+//Prints the timing report if one was asked for, passes on how the job went
+static bool reportStats(StatsReport & stats, Ostrich & emu, bool ok)
+{
+   if(stats.isEnabled())
+   {
+      stats.addPhases(emu.getPhaseTimes());
+      stats.setBytes(emu.getBytesSent(), emu.getBytesReceived());
+      stats.setRetries(emu.getRetryCount(), emu.getBlocksRetried());
+      stats.setResult(ok);
+      stats.writeJson(cout);
+   }
+   return ok;
+}
+
+int main (int argc, char **argv)
+{
+   Ostrich emu;
+   Action cmd = NOTHING;
+   string port;
+   string file;
+   string manifest;
+   string cacheFile;
+   int bank = Ostrich::wholeEnchilada;
+   StatsReport stats;
+   ostringstream target;
+   long started;
+   bool ok;
+   char * end;
+   int c;
+
+   opterr = 0;
+
+   while ((c = getopt_long (argc, argv, "p:b:w:r:v:j:c:J:h", longOptions, NULL)) != -1)
+      switch (c)
+      {
+      case 'p':
+         port.assign(optarg);
+         break;
+      case 'b':
+         bank = strtol(optarg, &end, 0);
+         if(*end != '\0' || bank < 0 || bank > Ostrich::wholeEnchilada)
+         {
+            cerr << "ERROR: Bank must be 0-" << Ostrich::wholeEnchilada << endl;
+            cerr << usage;
+            return false;
+         }
+         break;
+      case 'w':
+         cmd = WRITE;
+         file.assign(optarg);
+         break;
+      case 'r':
+         cmd = READ;
+         file.assign(optarg);
+         break;
+      case 'v':
+         cmd = VERIFY;
+         file.assign(optarg);
+         break;
+      case 'h':
+         cmd = HWCHECK;
+         break;
+      case 'j':
+         emu.setJournalFile(optarg);
+         break;
+      case 'c':
+         cacheFile.assign(optarg);
+         emu.setCacheFile(cacheFile);
+         break;
+      case 'J':
+         manifest.assign(optarg);
+         break;
+      case 's':
+         if(string(optarg) != "json")
+         {
+            cerr << "ERROR: --stats can only be json, not: " << optarg << endl;
+            cerr << usage;
+            return false;
+         }
+         stats.setEnabled(true);
+         break;
+      case '?':
+         if (optopt != 'h')
+         {
+            cerr << "ERROR: Option -"<< (char) optopt << "requires an argument" << endl;
+            cerr<< usage;
+            return false;
+         }
+         else if (isprint(optopt))
+         {
+            cerr << "ERROR: Unknown option -" <<	(char) optopt << endl;
+            cerr << usage;
+            return false;
+         }
+         else
+         {
+            cerr << "ERROR: Unknown option character " << hex << optopt << endl;
+            cerr << usage;
+            return false;
+         }
+      default:
+      {
+         cerr << usage;
+         return false;
+      }
+      }
+
+   //a read to stdout gets the bank and nothing else, the rest goes to stderr
+   if(cmd == READ && file == "-")
+      cout.rdbuf(cerr.rdbuf());
+
+   //the report covers one job on one Ostrich
+   if(stats.isEnabled() && !manifest.empty())
+   {
+      cerr << "ERROR: --stats=json is only for a single job" << endl << usage;
+      return false;
+   }
+
+   //Manifests carry their own ports
+   if(!manifest.empty())
+      return runManifest(manifest, cacheFile);
+
+   if(port.empty())
+   {
+      cerr << "ERROR: Com port must be provided." << endl << usage;
+      return false;
+   }
+   if(cmd == NOTHING)
+   {
+      cerr << usage;
+      return false;
+   }
+
+   target << "bank " << bank;
+   stats.setTool("ostrich");
+   stats.setPort(port);
+   stats.setAction(actionName(cmd));
+   stats.setTarget(target.str());
+   stats.setFile(file);
+
+   started = Timer::currentMillis();
+   ok = emu.setComPort(port);
+   stats.addPhase("open", started);
+   if(ok)
+   {
+      started = Timer::currentMillis();
+      ok = emu.checkForDevice();
+      stats.addPhase("negotiate", started);
+   }
+   if( !ok )
+   {
+      cerr << "ERROR: device not found on " << port << endl;
+      return reportStats(stats, emu, false);
+   }
+
+   cout << "Found device! Version is: "
+        << (int) emu.getHardwareVersion() << "."
+        << (int) emu.getFirmwareVersion() << "."
+        << emu.getHardwareVersionCH()
+        << endl;
+   if( cmd == HWCHECK)
+      return reportStats(stats, emu, true);
+
+   if(!emu.setBank(bank, 'U'))
+   {
+      cerr << "ERROR: couldn't set bank " << bank << endl;
+      return reportStats(stats, emu, false);
+   }
+
+   ok = runCommand(emu, cmd, bank, file);
+   return reportStats(stats, emu, ok);
+}